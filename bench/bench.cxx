@@ -0,0 +1,550 @@
+// HID parser/decoder microbenchmarks
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+// Runs without a device: parses a corpus of report descriptors, decodes
+// pseudo-random report streams, drives a simulated BU0836A through the
+// controller, and prints the results as JSON on stdout.
+//
+//   bench [-q]     (-q: fewer iterations, for a quick smoke test)
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "../bu0836.hxx"
+#include "../hid.hxx"
+#include "../logging.hxx"
+#include "../simulator.hxx"
+
+using namespace std;
+
+
+
+namespace {
+
+unsigned long allocations = 0;
+
+// Out of line, so that GCC doesn't pair operator new/delete with malloc/free
+// and warn about a mismatch (-Wmismatched-new-delete).
+__attribute__((noinline)) void *counted_malloc(size_t size)
+{
+	allocations++;
+	return malloc(size ? size : 1);
+}
+
+
+
+__attribute__((noinline)) void counted_free(void *p)
+{
+	free(p);
+}
+
+} // namespace
+
+
+
+#if __cplusplus >= 201103L
+void *operator new(size_t size)
+#else
+void *operator new(size_t size) throw(std::bad_alloc)
+#endif
+{
+	void *p = counted_malloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+
+
+void operator delete(void *p) throw()
+{
+	counted_free(p);
+}
+
+
+
+namespace {
+
+double now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+
+class nullbuf : public streambuf {
+protected:
+	int overflow(int c) { return c; }
+	streamsize xsputn(const char *, streamsize n) { return n; }
+};
+
+
+
+// builds a report descriptor from short items
+class descriptor {
+public:
+	enum { MAIN = 0, GLOBAL = 1, LOCAL = 2 };
+
+	descriptor &item(int type, int tag, uint32_t value) {
+		int size = value > 0xffff ? 3 : value > 0xff ? 2 : 1;
+		_data.push_back(tag << 4 | type << 2 | size);
+		_data.push_back(value & 0xff);
+		if (size > 1)
+			_data.push_back(value >> 8 & 0xff);
+		if (size > 2) {
+			_data.push_back(value >> 16 & 0xff);
+			_data.push_back(value >> 24 & 0xff);
+		}
+		return *this;
+	}
+
+	descriptor &usage_page(uint32_t v) { return item(GLOBAL, 0x0, v); }
+	descriptor &logical(uint32_t min, uint32_t max) { return item(GLOBAL, 0x1, min).item(GLOBAL, 0x2, max); }
+	descriptor &size(uint32_t v) { return item(GLOBAL, 0x7, v); }
+	descriptor &report_id(uint32_t v) { return item(GLOBAL, 0x8, v); }
+	descriptor &count(uint32_t v) { return item(GLOBAL, 0x9, v); }
+	descriptor &push() { _data.push_back(0xa4); return *this; }
+	descriptor &pop() { _data.push_back(0xb4); return *this; }
+	descriptor &usage(uint32_t v) { return item(LOCAL, 0x0, v); }
+	descriptor &usage_range(uint32_t min, uint32_t max) { return item(LOCAL, 0x1, min).item(LOCAL, 0x2, max); }
+	descriptor &input(uint32_t v) { return item(MAIN, 0x8, v); }
+	descriptor &output(uint32_t v) { return item(MAIN, 0x9, v); }
+	descriptor &collection(uint32_t v) { return item(MAIN, 0xa, v); }
+	descriptor &end_collection() { _data.push_back(0xc0); return *this; }
+
+	const vector<unsigned char> &data() const { return _data; }
+
+private:
+	vector<unsigned char> _data;
+};
+
+
+
+// the BU0836A's descriptor: 8 axes (12 bit data in 16 bit fields), hat, 32 buttons
+const unsigned char bu0836a[] = {
+	0x05, 0x01, 0x09, 0x04, 0xa1, 0x01,
+	0x09, 0x01, 0xa1, 0x00,
+	0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x33, 0x09, 0x34, 0x09, 0x35, 0x09, 0x36, 0x09, 0x36,
+	0x15, 0x00, 0x26, 0xff, 0x0f, 0x75, 0x10, 0x95, 0x08, 0x81, 0x02,
+	0xc0,
+	0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x35, 0x00, 0x46, 0x3b, 0x01, 0x65, 0x14,
+	0x75, 0x04, 0x95, 0x01, 0x81, 0x42,
+	0x75, 0x04, 0x95, 0x01, 0x81, 0x03,
+	0x05, 0x09, 0x19, 0x01, 0x29, 0x20, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x20, 0x81, 0x02,
+	0x75, 0x07, 0x95, 0x01, 0x81, 0x03,
+	0xc0,
+};
+
+
+
+// 8 axes packed into 10 bit fields (unaligned), hat, 32 buttons
+descriptor packed()
+{
+	descriptor d;
+	d.usage_page(0x01).usage(0x04).collection(0x01);
+	d.usage(0x01).collection(0x00);
+	for (int i = 0; i < 8; i++)
+		d.usage(0x30 + i);
+	d.logical(0, 0x3ff).size(10).count(8).input(0x02);
+	d.end_collection();
+	d.usage(0x39).logical(0, 7).size(4).count(1).input(0x42);
+	d.usage_page(0x09).usage_range(1, 32).logical(0, 1).size(1).count(32).input(0x02);
+	d.size(4).count(1).input(0x03);
+	d.end_collection();
+	return d;
+}
+
+
+
+// joystick, keyboard and consumer control with report ids and LED outputs
+descriptor multi()
+{
+	descriptor d;
+	d.usage_page(0x01).usage(0x04).collection(0x01).report_id(1);
+	d.usage(0x01).collection(0x00);
+	d.usage(0x30).usage(0x31).usage(0x32).usage(0x35);
+	d.logical(0, 0xffff).size(16).count(4).input(0x02);
+	d.end_collection();
+	d.usage_page(0x09).usage_range(1, 16).logical(0, 1).size(1).count(16).input(0x02);
+	d.end_collection();
+
+	d.usage_page(0x01).usage(0x06).collection(0x01).report_id(2);
+	d.usage_page(0x07).usage_range(0xe0, 0xe7).logical(0, 1).size(1).count(8).input(0x02);
+	d.size(8).count(1).input(0x03);
+	d.usage_page(0x08).usage_range(1, 5).size(1).count(5).output(0x02);
+	d.size(3).count(1).output(0x03);
+	d.usage_page(0x07).usage_range(0, 0xe7).logical(0, 0xe7).size(8).count(6).input(0x00);
+	d.end_collection();
+
+	d.usage_page(0x0c).usage(0x01).collection(0x01).report_id(3);
+	d.usage_range(0, 0x23c).logical(0, 0x23c).size(16).count(2).input(0x00);
+	d.end_collection();
+	return d;
+}
+
+
+
+// many nested collections, with global state saved and restored
+descriptor large()
+{
+	descriptor d;
+	d.usage_page(0x01).usage(0x04).collection(0x01);
+	for (int c = 0; c < 32; c++) {
+		d.push();
+		d.usage(0x01).collection(0x00);
+		for (int i = 0; i < 8; i++)
+			d.usage(0x30 + i);
+		d.logical(0, 0xfff).size(12).count(8).input(0x02);
+		d.usage(0x39).logical(0, 7).size(4).count(1).input(0x42);
+		d.usage_page(0x09).usage_range(1, 64).logical(0, 1).size(1).count(64).input(0x02);
+		d.size(4).count(1).input(0x03);
+		d.end_collection();
+		d.pop();
+	}
+	d.end_collection();
+	return d;
+}
+
+
+
+struct result {
+	string name;
+	size_t descriptor_bytes;
+	size_t items;
+	size_t values;
+	size_t report_bytes;
+	double parse_ns;
+	double parse_allocs;
+	double unsigned_ns;
+	double signed_ns;
+	double print_ns;
+	double decode_allocs;
+	double print_allocs;
+};
+
+
+
+const unsigned int ROUNDS = 5;
+volatile uint32_t sink;
+
+
+
+// the decode loop of controller::print_input(), without the output
+uint32_t decode_unsigned(const hid::hid &h, const unsigned char *data)
+{
+	const vector<hid::hid_main_item> &items = h.items();
+	const vector<hid::hid_value> &values = h.values();
+	uint32_t sum = 0;
+
+	vector<hid::hid_main_item>::const_iterator item, end = items.end();
+	for (item = items.begin(); item != end; ++item) {
+		if (item->type() != hid::INPUT || (item->data_type() & 1))
+			continue;
+		for (unsigned int i = item->first_value(); i < item->end_value(); i++)
+			sum += values[i].get_unsigned(data);
+	}
+	return sum;
+}
+
+
+
+uint32_t decode_signed(const hid::hid &h, const unsigned char *data)
+{
+	const vector<hid::hid_value> &values = h.values();
+	uint32_t sum = 0;
+	for (size_t i = 0; i < values.size(); i++)
+		sum += values[i].get_signed(data);
+	return sum;
+}
+
+
+
+result run(const string &name, const unsigned char *desc, size_t len, unsigned int scale)
+{
+	result r;
+	r.name = name;
+	r.descriptor_bytes = len;
+
+	// parse
+	unsigned int n = 2000 / scale;
+	double best = 1e30;
+	unsigned long allocs = 0;
+	for (unsigned int round = 0; round < ROUNDS; round++) {
+		unsigned long a = allocations;
+		double t = now_ns();
+		for (unsigned int i = 0; i < n; i++) {
+			hid::hid h;
+			h.parse(desc, len);
+		}
+		t = (now_ns() - t) / n;
+		if (t < best)
+			best = t;
+		allocs = allocations - a;
+	}
+	r.parse_ns = best;
+	r.parse_allocs = double(allocs) / n;
+
+	hid::hid h;
+	h.parse(desc, len);
+	r.items = h.items().size();
+	r.values = h.values().size();
+
+	// a stream of pseudo-random reports; get_unsigned() reads eight bytes
+	// from a field's first byte, so that's what each report needs
+	r.report_bytes = 1;
+	for (size_t i = 0; i < h.values().size(); i++) {
+		size_t end = h.values()[i].offset() / 8 + hid::REPORT_PADDING;
+		if (end > r.report_bytes)
+			r.report_bytes = end;
+	}
+
+	const unsigned int REPORTS = 256;
+	vector<unsigned char> stream(REPORTS * r.report_bytes + 8);
+	uint32_t seed = 0x0836;
+	for (size_t i = 0; i < stream.size(); i++) {
+		seed = seed * 1103515245 + 12345;
+		stream[i] = seed >> 16;
+	}
+
+	unsigned int passes = 200 / scale;
+	double best_u = 1e30, best_s = 1e30;
+	unsigned long decode_allocs = 0;
+	for (unsigned int round = 0; round < ROUNDS; round++) {
+		unsigned long a = allocations;
+		double t = now_ns();
+		for (unsigned int p = 0; p < passes; p++)
+			for (unsigned int i = 0; i < REPORTS; i++)
+				sink = decode_unsigned(h, &stream[i * r.report_bytes]);
+		t = (now_ns() - t) / (passes * REPORTS);
+		if (t < best_u)
+			best_u = t;
+
+		t = now_ns();
+		for (unsigned int p = 0; p < passes; p++)
+			for (unsigned int i = 0; i < REPORTS; i++)
+				sink = decode_signed(h, &stream[i * r.report_bytes]);
+		t = (now_ns() - t) / (passes * REPORTS);
+		if (t < best_s)
+			best_s = t;
+		decode_allocs = allocations - a;
+	}
+	r.unsigned_ns = best_u;
+	r.signed_ns = best_s;
+	r.decode_allocs = double(decode_allocs) / (2 * passes * REPORTS);
+
+	// verbose printer, into a null stream
+	nullbuf nb;
+	streambuf *old = cout.rdbuf(&nb);
+	passes = 20 / scale;
+	double best_p = 1e30;
+	unsigned long print_allocs = 0;
+	for (unsigned int round = 0; round < ROUNDS; round++) {
+		unsigned long a = allocations;
+		double t = now_ns();
+		for (unsigned int p = 0; p < passes; p++)
+			for (unsigned int i = 0; i < REPORTS; i++)
+				h.print_input_report(&stream[i * r.report_bytes]);
+		t = (now_ns() - t) / (passes * REPORTS);
+		if (t < best_p)
+			best_p = t;
+		print_allocs = allocations - a;
+	}
+	cout.rdbuf(old);
+	r.print_ns = best_p;
+	r.print_allocs = double(print_allocs) / (passes * REPORTS);
+	return r;
+}
+
+// cost of a disabled log statement, with and without LOG()
+void run_logging(double &log_ns, double &macro_ns, unsigned int scale)
+{
+	const unsigned char item[] = { 0x26, 0xff, 0x0f };
+	unsigned int n = 100000 / scale;
+	log_ns = macro_ns = 1e30;
+	for (unsigned int round = 0; round < ROUNDS; round++) {
+		double t = now_ns();
+		for (unsigned int i = 0; i < n; i++)
+			logging::log(logging::BULK) << "item " << i << ": " << logging::bytes(item, sizeof(item), 19);
+		t = (now_ns() - t) / n;
+		if (t < log_ns)
+			log_ns = t;
+
+		t = now_ns();
+		for (unsigned int i = 0; i < n; i++)
+			LOG(logging::BULK) << "item " << i << ": " << logging::bytes(item, sizeof(item), 19);
+		t = (now_ns() - t) / n;
+		if (t < macro_ns)
+			macro_ns = t;
+	}
+}
+
+
+
+
+struct sim_result {
+	double open_ns;
+	double read_ns;                      // whole EEPROM, first time
+	unsigned long read_transfers;
+	double reread_ns;                    // with the learned page order
+	unsigned long reread_transfers;
+	double sync_ns;
+	double sync_sim_ms;                  // simulated USB time
+	unsigned long sync_writes;
+	double report_ns;                    // interrupt transfer + decode()
+	double report_sim_ms;
+	unsigned long reports;
+};
+
+
+
+void fail(const char *msg)
+{
+	fprintf(stderr, "bench: simulator: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+
+
+// the controller on a simulated board, at full speed
+sim_result run_simulator(unsigned int scale)
+{
+	sim_result r;
+	bu0836::simulator::config cfg;
+	cfg.realtime = false;
+	bu0836::simulator *sim = new bu0836::simulator(cfg);
+	const bu0836::simulator::board &b = sim->boards()[0];
+
+	double t = now_ns();
+	bu0836::manager m(sim);
+	bu0836::controller &c = m[0];
+	if (c.claim() || c.require_layout())
+		fail("cannot claim device");
+	r.open_ns = now_ns() - t;
+
+	unsigned long transfers = b.feature_reports;
+	t = now_ns();
+	if (c.get_eeprom(bu0836::EEPROM_FIRST, bu0836::EEPROM_LAST))
+		fail("cannot read EEPROM");
+	r.read_ns = now_ns() - t;
+	r.read_transfers = b.feature_reports - transfers;
+
+	transfers = b.feature_reports;
+	t = now_ns();
+	c.get_eeprom(bu0836::EEPROM_FIRST, bu0836::EEPROM_LAST);
+	r.reread_ns = now_ns() - t;
+	r.reread_transfers = b.feature_reports - transfers;
+
+	for (int i = 0; i < 8; i++)
+		c.set_zoom(i, 100 + i);
+	unsigned long writes = b.writes;
+	uint64_t clock = sim->clock_us();
+	t = now_ns();
+	if (c.sync())
+		fail("cannot write EEPROM");
+	r.sync_ns = now_ns() - t;
+	r.sync_sim_ms = (sim->clock_us() - clock) / 1000.0;
+	r.sync_writes = b.writes - writes;
+
+	r.reports = 2000 / scale;
+	// the transfer and decode() of read_input_reports(), without its pause
+	unsigned char buf[1024];
+	bu0836::state st;
+	clock = sim->clock_us();
+	t = now_ns();
+	for (unsigned long i = 0; i < r.reports; i++) {
+		int len = 0;
+		if (c.usb()->interrupt_transfer(LIBUSB_ENDPOINT_IN | 1, buf,
+				sizeof(buf) - hid::REPORT_PADDING, &len, 100) < 0)
+			fail("cannot read input report");
+		c.decode(buf, st);
+	}
+	r.report_ns = (now_ns() - t) / r.reports;
+	r.report_sim_ms = (sim->clock_us() - clock) / 1000.0;
+	return r;
+}
+
+} // namespace
+
+
+
+int main(int argc, const char *argv[])
+{
+	unsigned int scale = argc > 1 && !strcmp(argv[1], "-q") ? 10 : 1;
+	logging::set_log_level(logging::WARN);
+
+	vector<result> results;
+	results.push_back(run("bu0836a", bu0836a, sizeof(bu0836a), scale));
+
+	descriptor d = packed();
+	results.push_back(run("packed", &d.data()[0], d.data().size(), scale));
+	d = multi();
+	results.push_back(run("multi", &d.data()[0], d.data().size(), scale));
+	d = large();
+	results.push_back(run("large", &d.data()[0], d.data().size(), scale));
+
+	printf("{\n\t\"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const result &r = results[i];
+		printf("\t\t{\n");
+		printf("\t\t\t\"descriptor\": \"%s\",\n", r.name.c_str());
+		printf("\t\t\t\"descriptor_bytes\": %lu,\n", (unsigned long)r.descriptor_bytes);
+		printf("\t\t\t\"items\": %lu,\n", (unsigned long)r.items);
+		printf("\t\t\t\"values\": %lu,\n", (unsigned long)r.values);
+		printf("\t\t\t\"parse_ns\": %.1f,\n", r.parse_ns);
+		printf("\t\t\t\"parse_allocs\": %.2f,\n", r.parse_allocs);
+		printf("\t\t\t\"decode_unsigned_ns_per_report\": %.1f,\n", r.unsigned_ns);
+		printf("\t\t\t\"decode_signed_ns_per_report\": %.1f,\n", r.signed_ns);
+		printf("\t\t\t\"decode_allocs_per_report\": %.2f,\n", r.decode_allocs);
+		printf("\t\t\t\"print_ns_per_report\": %.1f,\n", r.print_ns);
+		printf("\t\t\t\"print_allocs_per_report\": %.2f\n", r.print_allocs);
+		printf("\t\t}%s\n", i + 1 < results.size() ? "," : "");
+	}
+	printf("\t],\n");
+
+	double log_ns, macro_ns;
+	run_logging(log_ns, macro_ns, scale);
+	printf("\t\"disabled_logging\": {\n");
+	printf("\t\t\"log_ns\": %.1f,\n", log_ns);
+	printf("\t\t\"LOG_ns\": %.2f\n", macro_ns);
+	printf("\t},\n");
+
+	sim_result s = run_simulator(scale);
+	printf("\t\"simulator\": {\n");
+	printf("\t\t\"open_ns\": %.0f,\n", s.open_ns);
+	printf("\t\t\"eeprom_read_ns\": %.0f,\n", s.read_ns);
+	printf("\t\t\"eeprom_read_transfers\": %lu,\n", s.read_transfers);
+	printf("\t\t\"eeprom_reread_ns\": %.0f,\n", s.reread_ns);
+	printf("\t\t\"eeprom_reread_transfers\": %lu,\n", s.reread_transfers);
+	printf("\t\t\"sync_ns\": %.0f,\n", s.sync_ns);
+	printf("\t\t\"sync_simulated_ms\": %.1f,\n", s.sync_sim_ms);
+	printf("\t\t\"sync_writes\": %lu,\n", s.sync_writes);
+	printf("\t\t\"reports\": %lu,\n", s.reports);
+	printf("\t\t\"ns_per_report\": %.0f,\n", s.report_ns);
+	printf("\t\t\"reports_simulated_ms\": %.1f\n", s.report_sim_ms);
+	printf("\t}\n}\n");
+	return 0;
+}
@@ -16,6 +16,7 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 //
+#include <cstdio>  // rename
 #include <cstring> // memcpy
 #include <fstream>
 #include <iomanip>
@@ -27,7 +28,10 @@
 #include "bu0836.hxx"
 #include "hid.hxx"
 #include "logging.hxx"
+#include "metrics.hxx"
 #include "options.h"
+#include "trace.hxx"
+#include "transport.hxx"
 
 using namespace std;
 using namespace logging;
@@ -54,40 +58,20 @@ void interrupt_handler(int)
 
 
 
-const char *usb_strerror(int errno)
-{
-	switch (errno) {
-	case LIBUSB_SUCCESS:
-		return "success";
-	case LIBUSB_ERROR_IO:
-		return "input/output error";
-	case LIBUSB_ERROR_INVALID_PARAM:
-		return "invalid parameter";
-	case LIBUSB_ERROR_ACCESS:
-		return "access denied (insufficient permissions)";
-	case LIBUSB_ERROR_NO_DEVICE:
-		return "no such device (it may have been disconnected)";
-	case LIBUSB_ERROR_NOT_FOUND:
-		return "entity not found";
-	case LIBUSB_ERROR_BUSY:
-		return "resource busy";
-	case LIBUSB_ERROR_TIMEOUT:
-		return "operation timed out";
-	case LIBUSB_ERROR_OVERFLOW:
-		return "overflow";
-	case LIBUSB_ERROR_PIPE:
-		return "pipe error";
-	case LIBUSB_ERROR_INTERRUPTED:
-		return "system call interrupted (perhaps due to signal)";
-	case LIBUSB_ERROR_NO_MEM:
-		return "insufficient memory";
-	case LIBUSB_ERROR_NOT_SUPPORTED:
-		return "operation not supported or unimplemented on this platform";
-	case LIBUSB_ERROR_OTHER:
-		return "other error";
-	default:
-		return "unknown error code";
+// number of bytes that controller::decode() reads
+unsigned int input_report_size(const hid::hid &h)
+{
+	const vector<hid::hid_main_item> &items = h.items();
+	const vector<hid::hid_value> &values = h.values();
+	unsigned int bits = 0;
+	for (unsigned int i = 0; i < items.size(); i++) {
+		if (items[i].type() != hid::INPUT)
+			continue;
+		for (unsigned int k = items[i].first_value(); k < items[i].end_value(); k++)
+			if (values[k].offset() + values[k].width() > bits)
+				bits = values[k].offset() + values[k].width();
 	}
+	return (bits + 7) / 8;
 }
 
 
@@ -109,24 +93,188 @@ string strip(const string &s)
 	return start == string::npos || end == string::npos ? "" : s.substr(start, end - start + 1);
 }
 
+
+
+string string_descriptor(usb_device *usb, uint8_t index)
+{
+	if (!index)
+		return "";
+
+	unsigned char buf[256];
+	trace::span t("libusb_get_string_descriptor_ascii");
+	t.arg("index", index);
+	int ret = t.end(usb->get_string_descriptor_ascii(index, buf, sizeof(buf)));
+	return ret > 0 ? strip(string((char *)buf, ret)) : "";
+}
+
+
+
+// Pipelined EEPROM writer: every byte is sent as a separate 2-byte SET_REPORT
+// request, but up to controller::_EEPROM_WINDOW of them are in flight at once,
+// so that the per-request round trip latency only has to be paid once per window.
+struct eeprom_pipeline;
+
+struct eeprom_slot {
+	eeprom_pipeline *pipeline;
+	async_transfer *transfer;
+	unsigned char buf[LIBUSB_CONTROL_SETUP_SIZE + 2];
+	unsigned int address;
+	int tries;
+	bool busy;         // transfer owned by the transport
+	int lane;          // trace lane; slots overlap, so each gets its own
+	trace::span span;  // SET_REPORT in flight
+};
+
+struct eeprom_pipeline {
+	const unsigned char *image;
+	unsigned int next;
+	unsigned int last;
+	int max_tries;
+	int in_flight;
+	int retries;
+	int errors;
+	metrics::counters *metrics;
+};
+
+
+
+void eeprom_write_done(async_transfer *, int status);
+
+int submit_eeprom_write(eeprom_slot *slot)
+{
+	libusb_fill_control_setup(slot->buf, /* CLASS SPECIFIC REQUEST OUT */ 0x21,
+			/* SET_REPORT */ 0x09, /* FEATURE */ 0x0300, 0, 2);
+	slot->buf[LIBUSB_CONTROL_SETUP_SIZE] = slot->address;
+	slot->buf[LIBUSB_CONTROL_SETUP_SIZE + 1] = slot->pipeline->image[slot->address];
+	slot->transfer->done = eeprom_write_done;
+	slot->transfer->user_data = slot;
+	slot->tries++;
+
+	slot->span = trace::span("SET_REPORT", slot->lane);
+	slot->span.arg("address", slot->address).arg("try", slot->tries);
+	int ret = slot->transfer->submit(slot->buf, 1000 /* ms */);
+	if (ret < 0) {
+		slot->span.end(ret);
+		slot->pipeline->metrics->error(ret);
+		log(ALERT) << "set_eeprom/submit: " << usb_strerror(ret) << endl;
+		return ret;
+	}
+	slot->pipeline->in_flight++;
+	slot->busy = true;
+	return 0;
+}
+
+
+
+// Called from transport::handle_events(). Retries rejected writes and refills
+// the slot with the next pending address.
+void eeprom_write_done(async_transfer *transfer, int status)
+{
+	eeprom_slot *slot = static_cast<eeprom_slot *>(transfer->user_data);
+	eeprom_pipeline *p = slot->pipeline;
+	p->in_flight--;
+	slot->busy = false;
+	slot->span.end(status);
+
+	if (status == LIBUSB_TRANSFER_CANCELLED)
+		return;
+
+	if (status != LIBUSB_TRANSFER_COMPLETED) {
+		log(WARN) << "set_eeprom: write to 0x" << hex << setw(2) << setfill('0') << slot->address << dec
+				<< " failed (status " << status << ", try " << slot->tries << ')' << endl;
+		if (slot->tries < p->max_tries) {
+			p->retries++;
+			if (!submit_eeprom_write(slot))
+				return;
+		}
+		p->errors++;
+	}
+
+	while (p->next <= p->last) {
+		slot->address = p->next++;
+		slot->tries = 0;
+		if (!submit_eeprom_write(slot))
+			return;
+		p->errors++;
+	}
+}
+
+
+
+// Bitmask of the 16 byte EEPROM pages that cover bytes from-to.
+unsigned int eeprom_pages(unsigned int from, unsigned int to)
+{
+	unsigned int pages = 0;
+	for (unsigned int page = from >> 4; page <= to >> 4; page++)
+		pages |= 1 << page;
+	return pages;
+}
+
+
+
+// Axes are the values of non-padding input items in a physical collection
+// (or in none). They are numbered in report order, not by usage: the
+// BU0836A lists Slider twice, for axes 6 and 7.
+bool is_axis_item(const vector<hid::hid_main_item> &items, const hid::hid_main_item &item)
+{
+	return item.type() == hid::INPUT && !(item.data_type() & 1)
+			&& (item.parent() < 0 || items[item.parent()].data_type() == 0);
+}
+
+
+
+bool print_state(const state &s, void *)
+{
+	for (int i = 0; i < BU0836_MAX_AXES; i++) {
+		if (s.axes & (1 << i)) {
+			double norm = double(s.axis[i]) / s.axis_max[i];
+			cout << "A" << i << '=' << cyan << setfill(' ') << setw(4) << s.axis[i] << reset
+					<< " (" << magenta << fixed << setprecision(4) << norm << reset << ") ";
+		}
+	}
+	if (s.axes)
+		cout << endl;
+
+	for (int i = 0; i < s.num_buttons; i++) {
+		if (i == 16)
+			cout << endl;
+		bool v = s.buttons & (1u << i);
+		cout << "B" << setw(2) << setfill('0') << i << '=' << (v ? red : green) << v << reset << ' ';
+	}
+	if (s.num_buttons)
+		cout << endl;
+
+	if (s.hat >= 0)
+		cout << "H" << '=' << brown << s.hat << reset << ' ' << endl;
+
+	cout << endl;
+	return !interrupted;
+}
+
 } // namespace
 
 
 
-controller::controller(libusb_device_handle *handle, libusb_device *device, libusb_device_descriptor desc,
-		int capabilities) :
-	_handle(handle),
-	_device(device),
+controller::controller(transport &t, usb_device *usb, libusb_device_descriptor desc, int capabilities) :
+	_transport(t),
+	_usb(usb),
 	_desc(desc),
 	_active_axes(0),
 	_capabilities(capabilities),
 	_hid_descriptor(0),
 	_claimed(false),
 	_kernel_detached(false),
-	_dirty(false)
+	_layout(false),
+	_dirty(false),
+	_image_dirty(false),
+	_last_page(-1),
+	_eeprom_pages(0)
 {
+	for (int i = 0; i < 16; i++)
+		_next_page[i] = -1;
+
 	ostringstream s;
-	s << int(libusb_get_bus_number(_device)) << ':' << int(libusb_get_device_address(_device));
+	s << _usb->bus_number() << ':' << _usb->address();
 	_bus_address = s.str();
 
 	s.str("");
@@ -135,15 +283,10 @@ controller::controller(libusb_device_handle *handle, libusb_device *device, libu
 
 	_release = bcd2str(_desc.bcdDevice);
 
-	unsigned char buf[256];
-	if (_desc.iManufacturer && libusb_get_string_descriptor_ascii(_handle, _desc.iManufacturer, buf, sizeof(buf)) > 0)
-		_manufacturer = strip(string((char *)buf));
-
-	if (_desc.iProduct && libusb_get_string_descriptor_ascii(_handle, _desc.iProduct, buf, sizeof(buf)) > 0)
-		_product = strip(string((char *)buf));
-
-	if (_desc.iSerialNumber && libusb_get_string_descriptor_ascii(_handle, _desc.iSerialNumber, buf, sizeof(buf)) > 0)
-		_serial = strip(string((char *)buf));
+	TIMING_PHASE("string descriptors");
+	_manufacturer = string_descriptor(_usb, _desc.iManufacturer);
+	_product = string_descriptor(_usb, _desc.iProduct);
+	_serial = string_descriptor(_usb, _desc.iSerialNumber);
 
 	_jsid = _manufacturer;
 	if (!_jsid.empty() && !_product.empty())
@@ -152,6 +295,8 @@ controller::controller(libusb_device_handle *handle, libusb_device *device, libu
 	if (!_jsid.empty() && !_serial.empty())
 		_jsid += ' ';
 	_jsid += _serial;
+
+	metrics::add(&_metrics, _bus_address, _serial);
 }
 
 
@@ -160,51 +305,66 @@ controller::~controller()
 {
 	int ret;
 	if (_claimed) {
-		ret = libusb_release_interface(_handle, _INTERFACE);
+		trace::span t("libusb_release_interface");
+		ret = t.end(_usb->release_interface(_INTERFACE));
 		if (ret < 0)
-			log(ALERT) << "libusb_release_interface: " << usb_strerror(ret) << endl;
+			log(ALERT) << "libusb_release_interface: " << usb_error(ret) << endl;
 	}
 
 	if (_kernel_detached) {
-		ret = libusb_attach_kernel_driver(_handle, _INTERFACE);
+		trace::span t("libusb_attach_kernel_driver");
+		ret = t.end(_usb->attach_kernel_driver(_INTERFACE));
 		if (ret < 0)
-			log(ALERT) << "libusb_attach_kernel_driver: " << usb_strerror(ret) << endl;
+			log(ALERT) << "libusb_attach_kernel_driver: " << usb_error(ret) << endl;
 	}
 
-	libusb_close(_handle);
+	delete _usb;
 	delete [] _hid_descriptor;
+	metrics::remove(&_metrics);
+}
+
+
+
+// counts the error for the metrics and returns its description
+const char *controller::usb_error(int error)
+{
+	_metrics.error(error);
+	return usb_strerror(error);
 }
 
 
 
+// Only detaches the kernel driver and claims the interface. Everything else
+// is fetched on demand by require_descriptor(), require_layout() and
+// require_eeprom().
 int controller::claim()
 {
-	int ret;
-	if (!_kernel_detached && libusb_kernel_driver_active(_handle, _INTERFACE)) {
-		ret = libusb_detach_kernel_driver(_handle, _INTERFACE);
+	int ret = 0;
+	if (!_kernel_detached) {
+		trace::span t("libusb_kernel_driver_active");
+		ret = t.end(_usb->kernel_driver_active(_INTERFACE));
+	}
+
+	if (ret) {
+		TIMING_PHASE("kernel detach");
+		trace::span t("libusb_detach_kernel_driver");
+		ret = t.end(_usb->detach_kernel_driver(_INTERFACE));
 		if (ret < 0) {
-			log(ALERT) << "libusb_detach_kernel_driver: " << usb_strerror(ret) << endl;
+			log(ALERT) << "libusb_detach_kernel_driver: " << usb_error(ret) << endl;
 			return ret;
 		}
 		_kernel_detached = true;
 	}
 
 	if (!_claimed) {
-		ret = libusb_claim_interface(_handle, _INTERFACE);
+		TIMING_PHASE("claim");
+		trace::span t("libusb_claim_interface");
+		ret = t.end(_usb->claim_interface(_INTERFACE));
 		if (ret < 0) {
-			log(ALERT) << "libusb_claim_interface: " << usb_strerror(ret) << endl;
+			log(ALERT) << "libusb_claim_interface: " << usb_error(ret) << endl;
 			return ret;
 		}
 		_claimed = true;
-		ret = parse_hid();
-		if (ret)
-			return ret;
-
-		_active_axes = get_active_axes(_hid.data()[0]);
-
-		ret = get_eeprom();
-		if (ret)
-			return ret;
 	}
 
 	return 0;
@@ -212,12 +372,18 @@ int controller::claim()
 
 
 
-int controller::parse_hid()
+int controller::require_descriptor()
 {
+	if (_hid_descriptor)
+		return 0;
+
+	TIMING_PHASE("HID descriptor");
 	unsigned char buf[255];
-	int ret = libusb_get_descriptor(_handle, LIBUSB_DT_HID, 0, buf, sizeof(buf));
+	trace::span th("libusb_get_descriptor");
+	th.arg("type", LIBUSB_DT_HID);
+	int ret = th.end(_usb->get_descriptor(LIBUSB_DT_HID, 0, buf, sizeof(buf)));
 	if (ret < 0) {
-		log(ALERT) << "libusb_get_descriptor: " << usb_strerror(ret) << endl;
+		log(ALERT) << "libusb_get_descriptor: " << usb_error(ret) << endl;
 		return ret;
 	}
 
@@ -233,42 +399,119 @@ int controller::parse_hid()
 				<< "  len=" << len << endl;
 
 		unsigned char *buf = new unsigned char[len];
-		ret = libusb_get_descriptor(_handle, LIBUSB_DT_REPORT, 0, buf, len);
+		trace::span tr("libusb_get_descriptor");
+		tr.arg("type", LIBUSB_DT_REPORT).arg("length", len);
+		ret = tr.end(_usb->get_descriptor(LIBUSB_DT_REPORT, 0, buf, len));
 		if (ret < 0)
-			log(ALERT) << "libusb_get_descriptor/LIBUSB_DT_REPORT: " << usb_strerror(ret) << endl;
+			log(ALERT) << "libusb_get_descriptor/LIBUSB_DT_REPORT: " << usb_error(ret) << endl;
 		else if (ret != len)
 			log(ALERT) << "libusb_get_descriptor/LIBUSB_DT_REPORT: only " << ret << " of " << len
 					<< " bytes delivered" << endl;
 		else
-			_hid.parse(buf, ret);
+			_report_descriptor.insert(_report_descriptor.end(), buf, buf + len);
 
 		delete [] buf;
 	}
+
+	return 0;
+}
+
+
+
+int controller::require_layout()
+{
+	if (_layout)
+		return 0;
+
+	int ret = require_descriptor();
+	if (ret)
+		return ret;
+
+	TIMING_PHASE("parse");
+	if (!_report_descriptor.empty())
+		_hid.parse(&_report_descriptor[0], _report_descriptor.size());
+
+	_active_axes = get_active_axes();
+	_layout = true;
 	return 0;
 }
 
 
 
-int controller::get_eeprom()
+// (Re-)reads bytes from-to from the device, discarding unsynced changes.
+int controller::get_eeprom(unsigned int from, unsigned int to)
+{
+	if (to < from || to >= sizeof(_eeprom))
+		throw(ORIGIN"get_eeprom: internal error");
+
+	unsigned int pages = eeprom_pages(from, to);
+	int ret = read_eeprom(reinterpret_cast<uint8_t *>(&_eeprom), pages);
+	if (!ret)
+		_eeprom_pages |= pages;
+	return ret;
+}
+
+
+
+// Makes sure that bytes from-to are available, but only reads pages that
+// haven't been read before.
+int controller::require_eeprom(unsigned int from, unsigned int to)
 {
+	if (to < from || to >= sizeof(_eeprom))
+		throw(ORIGIN"require_eeprom: internal error");
+
+	unsigned int pages = eeprom_pages(from, to) & ~_eeprom_pages;
+	if (!pages)
+		return 0;
+
+	int ret = read_eeprom(reinterpret_cast<uint8_t *>(&_eeprom), pages);
+	if (!ret)
+		_eeprom_pages |= pages;
+	return ret;
+}
+
+
+
+// Reads until all pages in the bitmask have been delivered. Pages that aren't
+// in the bitmask are only used to learn the device's page order.
+int controller::read_eeprom(uint8_t *image, unsigned int pages)
+{
+	TIMING_PHASE("EEPROM read");
+	unsigned int wanted = pages;
+	int predicted = predict_eeprom_transfers(pages);
+	int maxtries = predicted < 0 || predicted + 16 > 50 ? 50 : predicted + 16;
+	int transfers = 0;
+
 	unsigned char buf[17];
-	int progress = 0xffff;
-	int maxtries = 50;
-	while (progress && maxtries--) {
-		int ret = libusb_control_transfer(_handle, /* CLASS SPECIFIC REQUEST IN */ 0xa1,
-				/* GET_REPORT */ 0x01, /* FEATURE */ 0x0300, 0, buf, sizeof(buf), 1000 /* ms */);
+	while (pages && transfers < maxtries) {
+		transfers++;
+		trace::span t("GET_REPORT");
+		t.arg("bmRequestType", 0xa1).arg("bRequest", 0x01).arg("wValue", 0x0300).arg("wLength", sizeof(buf));
+		int ret = t.end(_usb->control_transfer(/* CLASS SPECIFIC REQUEST IN */ 0xa1,
+				/* GET_REPORT */ 0x01, /* FEATURE */ 0x0300, 0, buf, sizeof(buf), 1000 /* ms */));
 		if (ret < 0) {
-			log(ALERT) << "get_eeprom/libusb_control_transfer: " << usb_strerror(ret) << endl;
+			log(ALERT) << "get_eeprom/libusb_control_transfer: " << usb_error(ret) << endl;
 			return -1;
 		}
 		if (ret != sizeof(buf))
 			continue;
 		if (buf[0] & 0x0f)
 			continue;
-		progress &= ~(1 << (buf[0] >> 4));
-		memcpy(reinterpret_cast<uint8_t *>(&_eeprom) + buf[0], buf + 1, 16);
+
+		int page = buf[0] >> 4;
+		if (_last_page >= 0)
+			_next_page[_last_page] = page;
+		_last_page = page;
+
+		if (pages & (1 << page)) {
+			pages &= ~(1 << page);
+			memcpy(image + buf[0], buf + 1, 16);
+		}
 	}
-	if (!maxtries) {
+
+	log(DEBUG) << "get_eeprom: pages 0x" << hex << setw(4) << setfill('0') << wanted << dec << " in "
+			<< transfers << " transfers (predicted " << predicted << ')' << endl;
+	if (pages) {
 		log(ALERT) << "get_eeprom: unable to read whole EEPROM" << endl;
 		return -2;
 	}
@@ -277,23 +520,105 @@ int controller::get_eeprom()
 
 
 
+// Returns the number of transfers that the learned page order needs to cover
+// the pages in the bitmask, or -1 if the order isn't known (yet).
+int controller::predict_eeprom_transfers(unsigned int pages) const
+{
+	int page = _last_page;
+	for (int n = 1; n <= 16; n++) {
+		if (page < 0 || (page = _next_page[page]) < 0)
+			return -1;
+		pages &= ~(1 << page);
+		if (!pages)
+			return n;
+	}
+	return -1;
+}
+
+
+
 int controller::set_eeprom(unsigned int from, unsigned int to)
 {
 	if (to < from || to >= sizeof(_eeprom))
 		throw(ORIGIN"set_eeprom: internal error");
 
-	unsigned char buf[2];
-	unsigned char *eeprom = reinterpret_cast<uint8_t *>(&_eeprom);
-	for (unsigned int i = from; i <= to; i++) {
-		buf[0] = i;
-		buf[1] = eeprom[i];
-		int ret = libusb_control_transfer(_handle, /* CLASS SPECIFIC REQUEST OUT */ 0x21,
-				/* SET_REPORT */ 0x09, /* FEATURE */ 0x0300, 0, buf, 2, 1000 /* ms */);
-		if (ret < 0) {
-			log(ALERT) << "set_eeprom/libusb_control_transfer: " << usb_strerror(ret) << endl;
-			return -1;
+	// on the heap, in case transfers that can't be reaped have to be left behind
+	eeprom_pipeline &p = *new eeprom_pipeline;
+	eeprom_slot *slots = new eeprom_slot[_EEPROM_WINDOW];
+	p.image = reinterpret_cast<const uint8_t *>(&_eeprom);
+	p.next = from;
+	p.last = to;
+	p.max_tries = _EEPROM_TRIES;
+	p.in_flight = p.retries = p.errors = 0;
+	p.metrics = &_metrics;
+
+	int num = 0;
+	for (; num < _EEPROM_WINDOW && p.next <= p.last; num++) {
+		slots[num].pipeline = &p;
+		slots[num].address = p.next++;
+		slots[num].tries = 0;
+		slots[num].busy = false;
+		slots[num].lane = num + 1;
+		slots[num].transfer = _usb->alloc_control_transfer();
+		if (!slots[num].transfer || submit_eeprom_write(&slots[num])) {
+			if (!slots[num].transfer)
+				log(ALERT) << "set_eeprom/alloc_control_transfer: " << usb_error(LIBUSB_ERROR_NO_MEM) << endl;
+			p.errors++;
+			p.next = p.last + 1; // don't start any more writes
+			num++;
+			break;
 		}
 	}
+
+	int failures = 0;
+	while (p.in_flight) {
+		int ret = _transport.handle_events();
+		if (ret >= 0 || ret == LIBUSB_ERROR_INTERRUPTED)
+			continue;
+
+		if (!failures++) {
+			log(ALERT) << "set_eeprom/handle_events: " << usb_error(ret) << endl;
+			p.errors++;
+			p.next = p.last + 1;
+			p.max_tries = 0;
+			for (int i = 0; i < num; i++)
+				if (slots[i].busy)
+					slots[i].transfer->cancel();
+		} else if (failures > _EEPROM_DRAIN_TRIES) {
+			log(ALERT) << "set_eeprom: giving up on " << p.in_flight << " unfinished transfers" << endl;
+			break;
+		}
+	}
+
+	log(DEBUG) << "set_eeprom: wrote 0x" << hex << from << "-0x" << to << dec << " with "
+			<< p.retries << " retries" << endl;
+	int errors = p.errors;
+	bool abandoned = p.in_flight != 0;
+	for (int i = 0; i < num; i++)
+		if (!slots[i].busy)
+			delete slots[i].transfer;
+	if (!abandoned) {   // otherwise the transport may still write to the slots
+		delete[] slots;
+		delete &p;
+	}
+	if (abandoned || errors)
+		return -1;
+
+	// read back and verify
+	uint8_t image[sizeof(_eeprom)];
+	if (read_eeprom(image, eeprom_pages(from, to)))
+		return -2;
+
+	const uint8_t *written = reinterpret_cast<const uint8_t *>(&_eeprom);
+	int mismatch = 0;
+	for (unsigned int i = from; i <= to; i++)
+		if (image[i] != written[i])
+			mismatch++;
+
+	if (mismatch) {
+		log(ALERT) << "set_eeprom: verification failed (" << mismatch << " bytes differ)" << endl;
+		return -3;
+	}
 	return 0;
 }
 
@@ -322,47 +647,119 @@ int controller::load_image_file(const char *path)
 	if (!file)
 		throw string("cannot read from '") + path + '\'';
 	file.read(reinterpret_cast<char *>(&_eeprom), sizeof(_eeprom));
+	_eeprom_pages = 0xffff;
 
 	file.seekg(0, ifstream::end);
 	if (file.tellg() != sizeof(_eeprom))
 		throw string("file '") + path + "' has wrong size";
 
 	file.close();
+	_dirty = _image_dirty = true; // written by sync()
 	return 0;
 }
 
 
 
-int controller::show_input_reports()
+int controller::emit_decoder(const char *path)
 {
-	if (_hid.data().empty()) {
-		log(ALERT) << "show_input_reports: no hid data" << endl;
+	if (require_layout())
 		return 1;
+
+	// a few live reports, as test data for the generated decoder
+	vector<vector<unsigned char> > reports;
+	unsigned char buf[1024];
+	for (int i = 0; i < _DECODER_TEST_TRIES && reports.size() < _DECODER_TEST_REPORTS; i++) {
+		int len;
+		trace::span t("libusb_interrupt_transfer");
+		t.arg("endpoint", LIBUSB_ENDPOINT_IN | 1).arg("length", sizeof(buf) - hid::REPORT_PADDING);
+		len = 0;
+		int ret = _usb->interrupt_transfer(LIBUSB_ENDPOINT_IN | 1, buf,
+				sizeof(buf) - hid::REPORT_PADDING, &len, 100 /* ms */);
+		t.arg("transferred", len).end(ret);
+		if (ret == LIBUSB_ERROR_TIMEOUT)
+			continue;
+		if (ret < 0) {
+			log(ALERT) << "emit_decoder/libusb_interrupt_transfer: " << usb_error(ret) << endl;
+			return 1;
+		}
+		memset(buf + len, 0, hid::REPORT_PADDING);
+		reports.push_back(vector<unsigned char>(buf, buf + len + hid::REPORT_PADDING));
 	}
+	if (reports.empty())
+		log(WARN) << "emit_decoder: no input reports received, the decoder won't have test data" << endl;
 
-	struct sigaction sa;
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = 0;
-	sa.sa_handler = interrupt_handler;
-	sigaction(SIGHUP, &sa, NULL);
-	sigaction(SIGINT, &sa, NULL);
-	sigaction(SIGTERM, &sa, NULL);
-	sigaction(SIGQUIT, &sa, NULL);
+	// the target is only replaced once the whole header was generated and written
+	ostringstream header;
+	if (_hid.write_decoder(header, _jsid, reports))
+		return 1;
+
+	string tmp = string(path) + ".tmp";
+	ofstream file(tmp.c_str(), ofstream::trunc);
+	file << header.str();
+	file.close();
+	if (!file || rename(tmp.c_str(), path)) {
+		unlink(tmp.c_str());
+		throw string("cannot write to '") + path + '\'';
+	}
+	return 0;
+}
+
+
+
+// Reads input reports until the callback returns false or the device is
+// gone. Transfer errors are retried every 2 seconds.
+int controller::read_input_reports(state_callback callback, void *data)
+{
+	if (require_layout())
+		return 1;
+
+	unsigned int report_size = input_report_size(_hid);
+
+	if (_hid.items().size() < 2) { // root only
+		log(ALERT) << "read_input_reports: no hid data" << endl;
+		return 1;
+	}
 
 	unsigned char buf[1024];
 	int len;
+	bool failing = false;
+	state s;
 	do {
-		int ret = libusb_interrupt_transfer(_handle, LIBUSB_ENDPOINT_IN | 1, buf, sizeof(buf), &len, 100 /* ms */);
+		trace::span t("libusb_interrupt_transfer");
+		t.arg("endpoint", LIBUSB_ENDPOINT_IN | 1).arg("length", sizeof(buf) - hid::REPORT_PADDING);
+		len = 0;
+		int ret = _usb->interrupt_transfer(LIBUSB_ENDPOINT_IN | 1, buf,
+				sizeof(buf) - hid::REPORT_PADDING, &len, 100 /* ms */);
+		t.arg("transferred", len).end(ret);
 		if (ret < 0) {
-			log(ALERT) << "show_input_reports/libusb_interrupt_transfer: "
-					<< usb_strerror(ret) << ", " << len << endl;
+			if (ret == LIBUSB_ERROR_TIMEOUT)
+				metrics::counters::count(_metrics.timeouts);
+			else
+				failing = true;
+			log(ALERT) << "read_input_reports/libusb_interrupt_transfer: "
+					<< usb_error(ret) << ", " << len << endl;
+			if (ret == LIBUSB_ERROR_NO_DEVICE)
+				return 1;
 			sleep(2);
 			continue;
 		}
 
-		log(BULK) << endl << bytes(buf, len) << endl;
-		print_input(_hid.data()[0], buf);
-		cout << endl;
+		metrics::counters::count(_metrics.reports);
+		if (failing) {
+			metrics::counters::count(_metrics.reconnects);
+			failing = false;
+		}
+		if (unsigned(len) < report_size) {
+			metrics::counters::count(_metrics.decode_errors);
+			LOG(INFO) << "read_input_reports: short report (" << len << " of " << report_size
+					<< " bytes)" << endl;
+			continue;
+		}
+
+		LOG(BULK) << endl << bytes(buf, len) << endl;
+		decode(buf, s);
+		if (!callback(s, data))
+			break;
 
 		const struct timespec ts = {0, 100000};
 		nanosleep(&ts, 0);
@@ -372,58 +769,86 @@ int controller::show_input_reports()
 
 
 
-void controller::print_input(hid::hid_main_item *item, const unsigned char *data)
+int controller::show_input_reports()
 {
-	vector<hid::hid_main_item *>::const_iterator it, end = item->children().end();
-	for (it = item->children().begin(); it != end; ++it)
-		print_input(*it, data);
-
-	if (item->type() != hid::INPUT || (item->data_type() & 1)) // no padding
-		return;
+	struct sigaction sa;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sa.sa_handler = interrupt_handler;
+	sigaction(SIGHUP, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGQUIT, &sa, NULL);
 
-	uint32_t colltype = item->parent() ? item->parent()->data_type() : 0;
+	return read_input_reports(print_state, 0);
+}
 
-	vector<hid::hid_value>::const_iterator vit, vend = item->values().end();
-	int index = 0;
-	for (vit = item->values().begin(); vit != vend; ++vit, index++) {
-		uint32_t v = vit->get_unsigned(data);
-		if (colltype == 0) { // axis (physical)
-			int num = vit->usage() - 48; // Usage 'X' == 0x30
-			double norm = double(v) / item->global().logical_maximum;
-			cout << "A" << num << '=' << cyan << setfill(' ') << setw(4) << v << reset
-					<< " (" << magenta << fixed << setprecision(4) << norm << reset << ") ";
 
-		} else if (item->global().usage_table == 0x09) { // button
-			if (index == 16)
-				cout << endl;
-			cout << "B" << setw(2) << setfill('0') << index << '='
-					<< (v ? red : green) << v << reset << ' ';
 
-		} else if (item->global().usage_table == 0x01 && vit->usage() == 0x39) { // hat
-			cout << "H" << '=' <<  brown << v << reset << ' ';
+// Fills s from a complete input report (see input_report_size()). Needs the
+// layout.
+int controller::decode(const unsigned char *report, state &s) const
+{
+	const vector<hid::hid_main_item> &items = _hid.items();
+	const vector<hid::hid_value> &values = _hid.values();
+
+	s.axes = 0;
+	s.buttons = 0;
+	s.num_buttons = 0;
+	s.hat = -1;
+
+	int num = 0; // axis
+	vector<hid::hid_main_item>::const_iterator item, end = items.end();
+	for (item = items.begin(); item != end; ++item) {
+		if (item->type() != hid::INPUT || (item->data_type() & 1)) // no padding
+			continue;
 
-		} else {
-			log(WARN) << "something " << vit->name() << " " << vit->usage() << endl;
+		bool axis = is_axis_item(items, *item);
+		int index = 0;
+		for (unsigned int i = item->first_value(); i < item->end_value(); i++, index++) {
+			const hid::hid_value &val = values[i];
+			uint32_t v = val.get_unsigned(report);
+			if (axis) {
+				if (num < BU0836_MAX_AXES) {
+					s.axes |= 1 << num;
+					s.axis[num] = v;
+					s.axis_max[num] = item->global().logical_maximum;
+				}
+				num++;
+
+			} else if (item->global().usage_table == 0x09) { // button
+				if (index < BU0836_MAX_BUTTONS) {
+					s.buttons |= uint32_t(v ? 1 : 0) << index;
+					if (index >= s.num_buttons)
+						s.num_buttons = index + 1;
+				}
+
+			} else if (item->global().usage_table == 0x01 && val.usage() == 0x39) { // hat
+				s.hat = v;
+
+			} else {
+				LOG(WARN) << "something " << val.name() << " " << val.usage() << endl;
+			}
 		}
 	}
-	cout << endl;
+	return 0;
 }
 
 
 
-int controller::get_active_axes(hid::hid_main_item *item)
+// the axes that decode() reports
+int controller::get_active_axes() const
 {
-	int axes = 0;
-	vector<hid::hid_main_item *>::const_iterator it, end = item->children().end();
-	for (it = item->children().begin(); it != end; ++it)
-		axes |= get_active_axes(*it);
-
-	if (item->type() == hid::INPUT && !(item->data_type() & 1) // non-padding input
-			&& item->parent() && item->parent()->data_type() == 0) { // collection type
+	const vector<hid::hid_main_item> &items = _hid.items();
 
-		vector<hid::hid_value>::const_iterator vit, vend = item->values().end();
-		for (vit = item->values().begin(); vit != vend; ++vit)
-			axes |= 1 << (vit->usage() - 48);
+	int axes = 0, num = 0;
+	vector<hid::hid_main_item>::const_iterator item, end = items.end();
+	for (item = items.begin(); item != end; ++item) {
+		if (!is_axis_item(items, *item))
+			continue;
+		for (unsigned int i = item->first_value(); i < item->end_value(); i++, num++)
+			if (num < BU0836_MAX_AXES)
+				axes |= 1 << num;
 	}
 	return axes;
 }
@@ -454,29 +879,21 @@ int controller::get_encoder_mode(int b) const
 
 
 
-manager::manager(int debug_level)
+manager::manager(transport *t) : _transport(t ? t : new libusb_transport)
 {
-	int ret = libusb_init(_CONTEXT);
-	if (ret < 0)
-		throw string("libusb_init: ") + usb_strerror(ret);
-	libusb_set_debug(_CONTEXT, debug_level);
-
-	libusb_device **list;
-	int num = libusb_get_device_list(_CONTEXT, &list);
-	if (num < 0)
-		throw string("libusb_get_device_list: ") + usb_strerror(ret);
-
-	for (int i = 0; i < num; i++) {
-		libusb_device_handle *handle;
-		ret = libusb_open(list[i], &handle);
-		if (ret) {
-			log(ALERT) << "error: libusb_open: " << usb_strerror(ret) << endl;
-			continue;
-		}
+	vector<usb_device *> devices;
+	try {
+		_transport->open_devices(devices);
+	} catch (...) {
+		delete _transport;
+		throw;
+	}
 
-		libusb_device *dev = libusb_get_device(handle);
+	for (size_t i = 0; i < devices.size(); i++) {
+		usb_device *usb = devices[i];
 		libusb_device_descriptor desc;
-		ret = libusb_get_device_descriptor(dev, &desc);
+		trace::span td("libusb_get_device_descriptor");
+		int ret = td.end(usb->get_device_descriptor(&desc));
 
 		int capabilities = 0;
 
@@ -515,7 +932,7 @@ manager::manager(int debug_level)
 		}
 
 		if (!capabilities) {
-			libusb_close(handle);
+			delete usb;
 			continue;
 		}
 
@@ -526,9 +943,8 @@ manager::manager(int debug_level)
 		if (desc.bcdDevice < 0x0121)
 			capabilities &= ~ENCODER2;
 
-		_devices.push_back(new controller(handle, dev, desc, capabilities));
+		_devices.push_back(new controller(*_transport, usb, desc, capabilities));
 	}
-	libusb_free_device_list(list, 1);
 	_selected = size() == 1 ? _devices[0] : 0;
 }
 
@@ -539,7 +955,7 @@ manager::~manager()
 	vector<controller *>::const_iterator it, end = _devices.end();
 	for (it = _devices.begin(); it != end; ++it)
 		delete *it;
-	libusb_exit(_CONTEXT);
+	delete _transport;
 }
 
 
@@ -26,11 +26,19 @@
 #include <vector>
 
 #include "hid.hxx"
+#include "libbu0836.h"
+#include "metrics.hxx"
+#include "transport.hxx"
 
 
 
 namespace bu0836 {
 
+typedef bu0836_state state; // decoded input report (see libbu0836.h)
+
+// Called for every decoded input report. Returning false stops the stream.
+typedef bool (*state_callback)(const state &, void *data);
+
 enum capabilities {
 	INVERT = 0x1,
 	ZOOM = 0x2,
@@ -40,6 +48,15 @@ enum capabilities {
 
 
 
+enum eeprom_range {
+	EEPROM_FIRST = 0x00,
+	EEPROM_CONFIG_FIRST = 0x0b, // invert
+	EEPROM_CONFIG_LAST = 0x1a,  // pulse
+	EEPROM_LAST = 0xff,
+};
+
+
+
 struct usb_hid_descriptor {
 	uint8_t  bLength;		// 9
 	uint8_t  bDescriptorType;	// 33 -> LIBUSB_DT_HID
@@ -68,15 +85,20 @@ struct usb_hid_descriptor {
 
 class controller {
 public:
-	controller(libusb_device_handle *handle, libusb_device *device, libusb_device_descriptor desc,
-			int capabilities);
+	controller(transport &t, usb_device *usb, libusb_device_descriptor desc, int capabilities);
 	~controller();
 	int claim();
-	int get_eeprom();
+	int require_descriptor();
+	int require_layout();
+	int get_eeprom(unsigned int from, unsigned int to);
+	int require_eeprom(unsigned int from, unsigned int to);
 	int set_eeprom(unsigned int from, unsigned int to);
 	int save_image_file(const char *);
 	int load_image_file(const char *);
+	int decode(const unsigned char *report, state &s) const;
+	int read_input_reports(state_callback callback, void *data);
 	int show_input_reports();
+	int emit_decoder(const char *path);
 	int capabilities() const { return _capabilities; }
 	int active_axes() const { return _active_axes; }
 	bool is_dirty() const { return _dirty; }
@@ -88,7 +110,9 @@ public:
 	const std::string &serial() const { return _serial; }
 	const std::string &release() const { return _release; }
 	const std::string &jsid() const { return _jsid; }
+	const std::vector<unsigned char> &report_descriptor() const { return _report_descriptor; }
 	const unsigned char *eeprom() const { return reinterpret_cast<const unsigned char *>(&_eeprom); }
+	usb_device *usb() const { return _usb; }
 
 	void set_autodiscovery(bool b) { _eeprom.autodiscovery = b ? 1 : 0, _dirty = true; }
 	bool get_autodiscovery() const { return _eeprom.autodiscovery != 0; }
@@ -119,16 +143,18 @@ public:
 	int sync() {
 		if (!_dirty)
 			return 0;
-		int ret = set_eeprom(0x0b, 0x1a);
+		int ret = _image_dirty ? set_eeprom(EEPROM_FIRST, EEPROM_LAST)
+				: set_eeprom(EEPROM_CONFIG_FIRST, EEPROM_CONFIG_LAST);
 		if (!ret)
-			_dirty = false;
+			_dirty = _image_dirty = false;
 		return ret;
 	}
 
 private:
-	int parse_hid(void);
-	void print_input(hid::hid_main_item *, const unsigned char *data);
-	int get_active_axes(hid::hid_main_item *);
+	int read_eeprom(uint8_t *image, unsigned int pages);
+	int predict_eeprom_transfers(unsigned int pages) const;
+	const char *usb_error(int error);
+	int get_active_axes() const;
 
 	hid::hid _hid;
 
@@ -140,15 +166,26 @@ private:
 	std::string _release;
 	std::string _jsid;
 
-	libusb_device_handle *_handle;
-	libusb_device *_device;
+	transport &_transport;
+	usb_device *_usb; // owned
 	libusb_device_descriptor _desc;
 	int _active_axes;
 	int _capabilities;
 	usb_hid_descriptor *_hid_descriptor;
+	std::vector<unsigned char> _report_descriptor;
 	bool _claimed;
 	bool _kernel_detached;
+	bool _layout;
 	bool _dirty;
+	bool _image_dirty;                 // whole image (load_image_file())
+
+	// The device answers each FEATURE GET_REPORT with the next 16 byte EEPROM
+	// page of its own choosing. The observed successor of each page is recorded
+	// so that the number of transfers needed for a range can be predicted.
+	int8_t _next_page[16];
+	int _last_page;
+	unsigned int _eeprom_pages; // pages in _eeprom that were read from the device
+	metrics::counters _metrics;
 
 	struct {
 		uint8_t ___a[11];      // 0x00
@@ -163,13 +200,18 @@ private:
 	} _eeprom;
 
 	static const int _INTERFACE = 0;
+	static const int _EEPROM_WINDOW = 8; // max. number of EEPROM writes in flight
+	static const int _EEPROM_TRIES = 3;
+	static const int _EEPROM_DRAIN_TRIES = 10;     // failed handle_events() after cancelling
+	static const unsigned int _DECODER_TEST_REPORTS = 8;
+	static const int _DECODER_TEST_TRIES = 20;           // 100 ms each
 };
 
 
 
 class manager {
 public:
-	manager(int debug_level = 3);
+	explicit manager(transport *t = 0); // takes ownership; libusb if 0
 	~manager();
 	int select(const std::string &which);
 	controller *selected() const { return _selected; }
@@ -180,8 +222,7 @@ public:
 private:
 	std::vector<controller *> _devices;
 	controller *_selected;
-
-	static const int _CONTEXT = 0;
+	transport *_transport;
 };
 
 } // namespace bu0836
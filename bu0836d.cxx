@@ -0,0 +1,712 @@
+// bu0836d -- keeps BU0836 controllers claimed and serves them to bu0836
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <poll.h>
+#include <set>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "bu0836.hxx"
+#include "logging.hxx"
+#include "options.h"
+#include "remote.hxx"
+#include "simulator.hxx"
+
+#define EMAIL "<melchior.franz@gmail.com>"
+
+using namespace std;
+using namespace logging;
+namespace protocol = bu0836::protocol;
+
+
+
+namespace {
+
+bool interrupted = false;
+
+
+
+void interrupt_handler(int)
+{
+	interrupted = true;
+}
+
+
+
+void help(void)
+{
+	//      |---------1---------2---------3---------4---------5---------6---------7---------8
+	cout << "Usage: bu0836d [OPTION]..." << endl;
+	cout << endl;
+	cout << "Keeps all BU0836 controllers claimed, with their layout and EEPROM cached, and" << endl;
+	cout << "serves them to bu0836 over a Unix domain socket. Runs in the foreground." << endl;
+	cout << endl;
+	cout << "  -h, --help               show this help screen and exit" << endl;
+	cout << "      --version            show version number and exit" << endl;
+	cout << "  -v, --verbose            increase verbosity level (can be used three times)" << endl;
+	cout << "      --socket=PATH        listen on PATH (default: $BU0836_SOCKET, or" << endl;
+	cout << "                           $XDG_RUNTIME_DIR/bu0836.sock, or /tmp/bu0836-UID.sock)" << endl;
+	cout << "      --simulate[=NUMBER]  serve NUMBER simulated devices (default 1)" << endl;
+	cout << endl;
+	cout << "Report bugs to " EMAIL << endl;
+	//      |---------1---------2---------3---------4---------5---------6---------7---------8
+}
+
+
+
+void version(void)
+{
+	cout << STRINGIZE(VERSION) << endl << endl;
+	cout << "Copyright (C) Melchior FRANZ " EMAIL << endl;
+	cout << "License GPLv2+: GNU GPL version 2 or later <http://gnu.org/licenses/gpl-2.0.html>" << endl;
+	cout << "This is free software; see the source for copying conditions.  There is NO" << endl;
+	cout << "warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE." << endl;
+}
+
+
+
+class server {
+public:
+	server(bu0836::transport *t, const string &path);
+	~server();
+	void run();
+
+private:
+	struct report_reader;
+
+	struct device {
+		bu0836::controller *c;
+		vector<unsigned char> info;  // LIST entry
+		set<int> subscribers;        // client sockets
+		int in_flight;               // writes
+		int stale_from, stale_to;    // written EEPROM range, not read back yet
+		bool gone;
+		report_reader *reader;       // 0 if the transport has no interrupt transfers
+	};
+
+	// an interrupt transfer that is resubmitted while there are subscribers
+	struct report_reader {
+		server *s;
+		unsigned int device;
+		bool busy;                   // submitted, done() not called yet
+		bu0836::async_transfer *transfer;
+		unsigned char buf[1024];
+	};
+
+	struct pending_write {
+		server *s;
+		int client;                  // -1 if gone
+		uint32_t tag;
+		unsigned int device;
+		int status;
+		bool finished;
+		bu0836::async_transfer *transfer;
+		unsigned char buf[LIBUSB_CONTROL_SETUP_SIZE + 2];
+	};
+
+	void accept_client();
+	bool receive(int fd);
+	void drop(int fd);
+	bool reply(int fd, const protocol::header &request, int status, const void *data = 0, size_t length = 0);
+	void handle(int fd, const protocol::header &h, const unsigned char *payload);
+	void submit_write(int fd, const protocol::header &h, const unsigned char *payload);
+	static void write_done(bu0836::async_transfer *t, int status);
+	void finish_writes();
+	void wait_for_writes(device &d);
+	int refresh(device &d);
+	void read_reports(device &d);
+	static void report_done(bu0836::async_transfer *t, int status);
+	void stop_reports(device &d);
+
+	bu0836::transport *_transport;    // owned by _manager
+	bu0836::manager _manager;
+	vector<device> _devices;
+	vector<int> _clients;
+	list<pending_write *> _writes;
+	string _path;
+	int _fd;
+};
+
+
+
+server::server(bu0836::transport *t, const string &path) :
+	_transport(t),
+	_manager(t),
+	_path(path),
+	_fd(-1)
+{
+	for (size_t i = 0; i < _manager.size() && _devices.size() < 255; i++) {
+		bu0836::controller &c = _manager[i];
+		if (c.claim() || c.require_layout() || c.get_eeprom(bu0836::EEPROM_FIRST, bu0836::EEPROM_LAST)) {
+			log(ALERT) << "cannot access device '" << c.serial() << "', skipping it" << endl;
+			continue;
+		}
+
+		device d;
+		d.c = &c;
+		d.in_flight = 0;
+		d.stale_from = d.stale_to = -1;
+		d.gone = false;
+
+		bu0836::usb_device *usb = c.usb();
+		d.reader = new report_reader;
+		d.reader->s = this;
+		d.reader->device = _devices.size();
+		d.reader->busy = false;
+		d.reader->transfer = usb->alloc_interrupt_transfer(LIBUSB_ENDPOINT_IN | 1, sizeof(d.reader->buf));
+		if (d.reader->transfer) {
+			d.reader->transfer->done = report_done;
+			d.reader->transfer->user_data = d.reader;
+		} else {
+			log(WARN) << "no input reports from device '" << c.serial() << '\'' << endl;
+			delete d.reader;
+			d.reader = 0;
+		}
+
+		libusb_device_descriptor desc;
+		usb->get_device_descriptor(&desc);
+		d.info.push_back(usb->bus_number());
+		d.info.push_back(usb->address());
+		const unsigned char *p = reinterpret_cast<const unsigned char *>(&desc);
+		d.info.insert(d.info.end(), p, p + sizeof(desc));
+		const string *strings[] = { &c.manufacturer(), &c.product(), &c.serial() };
+		for (int k = 0; k < 3; k++) {
+			size_t len = strings[k]->size() < 255 ? strings[k]->size() : 255;
+			d.info.push_back(len);
+			d.info.insert(d.info.end(), strings[k]->begin(), strings[k]->begin() + len);
+		}
+		uint16_t len = c.report_descriptor().size();
+		p = reinterpret_cast<const unsigned char *>(&len);
+		d.info.insert(d.info.end(), p, p + 2);
+		d.info.insert(d.info.end(), c.report_descriptor().begin(), c.report_descriptor().end());
+
+		_devices.push_back(d);
+		log(INFO) << "serving " << c.bus_address() << ' ' << c.jsid() << endl;
+	}
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path))
+		throw string("socket path too long: ") + path;
+	strcpy(addr.sun_path, path.c_str());
+
+	int probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (probe >= 0) {
+		bool running = !connect(probe, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+		bool ours = running && protocol::same_user(probe);
+		close(probe);
+		if (ours)
+			throw string("bu0836d is already running on ") + path;
+		if (running)
+			throw string("another user listens on ") + path + "; use --socket";
+	}
+	unlink(path.c_str()); // stale
+
+	_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (_fd < 0)
+		throw string("socket: ") + strerror(errno);
+	mode_t mask = umask(077); // only for our user (see also accept_client())
+	int ret = bind(_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+	umask(mask);
+	if (ret < 0 || listen(_fd, 16) < 0) {
+		string msg = string("cannot listen on ") + path + ": " + strerror(errno);
+		close(_fd);
+		_fd = -1;
+		throw msg;
+	}
+	log(INFO) << "listening on " << path << endl;
+}
+
+
+
+server::~server()
+{
+	while (!_clients.empty())
+		drop(_clients.back());
+	for (list<pending_write *>::iterator it = _writes.begin(); it != _writes.end(); ++it)
+		(*it)->client = -1;
+	for (size_t i = 0; i < _devices.size(); i++) {
+		wait_for_writes(_devices[i]);
+		stop_reports(_devices[i]);
+	}
+	finish_writes();
+	if (_fd >= 0) {
+		close(_fd);
+		unlink(_path.c_str());
+	}
+}
+
+
+
+// Waits on the clients and on the transport at once, so that neither
+// writes nor input reports hold up the other clients.
+void server::run()
+{
+	while (!interrupted) {
+		for (size_t i = 0; i < _devices.size(); i++)
+			read_reports(_devices[i]);
+
+		vector<pollfd> fds;
+		pollfd pfd = { _fd, POLLIN, 0 };
+		fds.push_back(pfd);
+		for (size_t i = 0; i < _clients.size(); i++) {
+			pfd.fd = _clients[i];
+			fds.push_back(pfd);
+		}
+		size_t usb = fds.size();
+		int timeout;
+		int ret = _transport->get_pollfds(fds, &timeout);
+		if (ret < 0)
+			throw string("get_pollfds: ") + bu0836::usb_strerror(ret);
+
+		ret = poll(&fds[0], fds.size(), timeout);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			throw string("poll: ") + strerror(errno);
+		}
+
+		if (fds[0].revents & POLLIN)
+			accept_client();
+		for (size_t i = 1; i < usb; i++)
+			if (fds[i].revents && !receive(fds[i].fd))
+				drop(fds[i].fd);
+
+		ret = _transport->poll_events();
+		if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED)
+			log(ALERT) << "poll_events: " << bu0836::usb_strerror(ret) << endl;
+		finish_writes();
+	}
+}
+
+
+
+void server::accept_client()
+{
+	int fd = accept4(_fd, 0, 0, SOCK_CLOEXEC);
+	if (fd < 0) {
+		log(WARN) << "accept: " << strerror(errno) << endl;
+		return;
+	}
+	if (!protocol::same_user(fd)) {
+		log(WARN) << "client of another user refused" << endl;
+		close(fd);
+		return;
+	}
+	_clients.push_back(fd);
+	log(DEBUG) << "client " << fd << " connected" << endl;
+}
+
+
+
+// Reads and handles one message. Returns false if the client is gone.
+bool server::receive(int fd)
+{
+	static vector<unsigned char> payload(protocol::MAX_PAYLOAD);
+	protocol::header h;
+	iovec iov[2] = { { &h, sizeof(h) }, { &payload[0], payload.size() } };
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+
+	ssize_t n = recvmsg(fd, &msg, MSG_DONTWAIT);
+	if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		return true;
+	if (n <= 0)
+		return false;
+	if (size_t(n) < sizeof(h) || size_t(n) != sizeof(h) + h.length) {
+		log(WARN) << "client " << fd << ": malformed message" << endl;
+		return false;
+	}
+
+	handle(fd, h, &payload[0]);
+	return true;
+}
+
+
+
+void server::drop(int fd)
+{
+	log(DEBUG) << "client " << fd << " disconnected" << endl;
+	for (size_t i = 0; i < _devices.size(); i++)
+		_devices[i].subscribers.erase(fd);
+	for (list<pending_write *>::iterator it = _writes.begin(); it != _writes.end(); ++it)
+		if ((*it)->client == fd)
+			(*it)->client = -1;
+	for (size_t i = 0; i < _clients.size(); i++) {
+		if (_clients[i] == fd) {
+			_clients.erase(_clients.begin() + i);
+			break;
+		}
+	}
+	close(fd);
+}
+
+
+
+bool server::reply(int fd, const protocol::header &request, int status, const void *data, size_t length)
+{
+	protocol::header h = request;
+	h.length = length;
+	h.status = status;
+	iovec iov[2] = { { &h, sizeof(h) }, { const_cast<void *>(data), length } };
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = length ? 2 : 1;
+	ssize_t n;
+	while ((n = sendmsg(fd, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+		;
+	return n >= 0;
+}
+
+
+
+void server::handle(int fd, const protocol::header &h, const unsigned char *payload)
+{
+	if (h.type == protocol::LIST) {
+		vector<unsigned char> list(1, _devices.size());
+		for (size_t i = 0; i < _devices.size(); i++)
+			list.insert(list.end(), _devices[i].info.begin(), _devices[i].info.end());
+		reply(fd, h, 0, &list[0], list.size());
+		return;
+	}
+
+	if (h.device >= _devices.size()) {
+		reply(fd, h, LIBUSB_ERROR_NOT_FOUND);
+		return;
+	}
+	device &d = _devices[h.device];
+	if (d.gone && h.type != protocol::UNSUBSCRIBE) {
+		reply(fd, h, LIBUSB_ERROR_NO_DEVICE);
+		return;
+	}
+
+	switch (h.type) {
+	case protocol::READ: {
+		int ret = refresh(d);
+		if (ret)
+			reply(fd, h, ret);
+		else
+			reply(fd, h, 0, d.c->eeprom(), bu0836::EEPROM_LAST + 1);
+		break;
+	}
+
+	case protocol::WRITE:
+		submit_write(fd, h, payload);
+		break;
+
+	case protocol::SUBSCRIBE:
+		d.subscribers.insert(fd);
+		reply(fd, h, 0);
+		break;
+
+	case protocol::UNSUBSCRIBE:
+		d.subscribers.erase(fd);
+		break;
+
+	default:
+		reply(fd, h, LIBUSB_ERROR_NOT_SUPPORTED);
+	}
+}
+
+
+
+void server::submit_write(int fd, const protocol::header &h, const unsigned char *payload)
+{
+	if (h.length != 2) {
+		reply(fd, h, LIBUSB_TRANSFER_ERROR);
+		return;
+	}
+
+	device &d = _devices[h.device];
+	pending_write *w = new pending_write;
+	w->s = this;
+	w->client = fd;
+	w->tag = h.tag;
+	w->device = h.device;
+	w->status = LIBUSB_TRANSFER_ERROR;
+	w->finished = false;
+	w->transfer = d.c->usb()->alloc_control_transfer();
+	libusb_fill_control_setup(w->buf, /* CLASS SPECIFIC REQUEST OUT */ 0x21,
+			/* SET_REPORT */ 0x09, /* FEATURE */ 0x0300, 0, 2);
+	memcpy(w->buf + LIBUSB_CONTROL_SETUP_SIZE, payload, 2);
+
+	int ret = LIBUSB_ERROR_NO_MEM;
+	if (w->transfer) {
+		w->transfer->done = write_done;
+		w->transfer->user_data = w;
+		ret = w->transfer->submit(w->buf, 1000 /* ms */);
+	}
+	if (ret < 0) {
+		log(WARN) << "write to " << d.c->serial() << ": " << bu0836::usb_strerror(ret) << endl;
+		delete w->transfer;
+		delete w;
+		reply(fd, h, ret == LIBUSB_ERROR_NO_DEVICE ? LIBUSB_TRANSFER_NO_DEVICE : LIBUSB_TRANSFER_ERROR);
+		return;
+	}
+	d.in_flight++;
+	_writes.push_back(w);
+}
+
+
+
+void server::write_done(bu0836::async_transfer *t, int status)
+{
+	pending_write *w = static_cast<pending_write *>(t->user_data);
+	device &d = w->s->_devices[w->device];
+	w->status = status;
+	w->finished = true;
+	d.in_flight--;
+	if (status == LIBUSB_TRANSFER_COMPLETED) {
+		int address = w->buf[LIBUSB_CONTROL_SETUP_SIZE];
+		if (d.stale_from < 0 || address < d.stale_from)
+			d.stale_from = address;
+		if (address > d.stale_to)
+			d.stale_to = address;
+	}
+	if (status == LIBUSB_TRANSFER_NO_DEVICE)
+		d.gone = true;
+}
+
+
+
+// replies to all completed writes
+void server::finish_writes()
+{
+	list<pending_write *>::iterator it = _writes.begin();
+	while (it != _writes.end()) {
+		pending_write *w = *it;
+		if (!w->finished) {
+			++it;
+			continue;
+		}
+		if (w->client >= 0) {
+			protocol::header h = { protocol::WRITE, uint8_t(w->device), 0, w->tag, 0 };
+			reply(w->client, h, w->status);
+		}
+		delete w->transfer;
+		delete w;
+		it = _writes.erase(it);
+	}
+}
+
+
+
+void server::wait_for_writes(device &d)
+{
+	while (d.in_flight) {
+		int ret = _transport->handle_events();
+		if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED) {
+			log(ALERT) << "handle_events: " << bu0836::usb_strerror(ret) << endl;
+			break;
+		}
+	}
+}
+
+
+
+// Reads back what was written since the last READ, so that clients verify
+// against the device and not just against what they sent.
+int server::refresh(device &d)
+{
+	wait_for_writes(d);
+	if (d.stale_from < 0)
+		return 0;
+	int ret = d.c->get_eeprom(d.stale_from, d.stale_to);
+	if (ret)
+		return LIBUSB_ERROR_IO;
+	d.stale_from = d.stale_to = -1;
+	return 0;
+}
+
+
+
+// Keeps one interrupt transfer in flight while the device has subscribers.
+void server::read_reports(device &d)
+{
+	report_reader *r = d.reader;
+	if (!r || r->busy || d.subscribers.empty() || d.gone)
+		return;
+
+	int ret = r->transfer->submit(r->buf, 0 /* no timeout */);
+	if (ret < 0) {
+		log(ALERT) << d.c->serial() << ": " << bu0836::usb_strerror(ret) << endl;
+		if (ret == LIBUSB_ERROR_NO_DEVICE)
+			d.gone = true;
+		return;
+	}
+	r->busy = true;
+}
+
+
+
+// passes the report on to all subscribers, and asks for the next one
+void server::report_done(bu0836::async_transfer *t, int status)
+{
+	report_reader *r = static_cast<report_reader *>(t->user_data);
+	device &d = r->s->_devices[r->device];
+	r->busy = false;
+	if (status == LIBUSB_TRANSFER_CANCELLED)
+		return;
+	if (status == LIBUSB_TRANSFER_NO_DEVICE)
+		d.gone = true;
+	if (status != LIBUSB_TRANSFER_COMPLETED) {
+		log(ALERT) << d.c->serial() << ": input report transfer failed (status " << status << ')' << endl;
+		r->s->read_reports(d);
+		return;
+	}
+
+	protocol::header h = { protocol::REPORT, uint8_t(r->device), uint16_t(t->transferred), 0, 0 };
+	iovec iov[2] = { { &h, sizeof(h) }, { r->buf, size_t(t->transferred) } };
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+	for (set<int>::iterator it = d.subscribers.begin(); it != d.subscribers.end(); ++it)
+		sendmsg(*it, &msg, MSG_NOSIGNAL | MSG_DONTWAIT); // slow clients miss reports
+	r->s->read_reports(d);
+}
+
+
+
+void server::stop_reports(device &d)
+{
+	report_reader *r = d.reader;
+	if (!r)
+		return;
+	if (r->busy)
+		r->transfer->cancel();
+	while (r->busy) {
+		int ret = _transport->handle_events();
+		if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED) {
+			log(ALERT) << "handle_events: " << bu0836::usb_strerror(ret) << endl;
+			return; // still in flight, so leave it
+		}
+	}
+	delete r->transfer;
+	delete r;
+	d.reader = 0;
+}
+
+} // namespace
+
+
+
+int main(int argc, const char *argv[]) try
+{
+	enum { HELP_OPTION, VERSION_OPTION, VERBOSE_OPTION, SOCKET_OPTION, SIMULATE_OPTION };
+
+	const struct command_line_option options[] = {
+		{ "--help",           "-h", 0, "\0" },
+		{ "--version",           0, 0, "\0" },
+		{ "--verbose",        "-v", 0, "\0" },
+		{ "--socket",            0, 1, "\0" },
+		{ "--simulate",          0, 0, "\0" },  // optional argument
+		OPTIONS_LAST
+	};
+
+	int option;
+	struct option_parser_context ctx;
+	string path = protocol::socket_path();
+	bu0836::simulator::config simulate;
+	simulate.boards = 0;
+
+	set_log_level(WARN);
+	init_options_context(&ctx, argc, argv, options);
+	while ((option = get_option(&ctx)) != OPTIONS_DONE) {
+		switch (option) {
+		case HELP_OPTION:
+			help();
+			return EXIT_SUCCESS;
+
+		case VERSION_OPTION:
+			version();
+			return EXIT_SUCCESS;
+
+		case VERBOSE_OPTION:
+			set_log_level(get_log_level() - 1);
+			break;
+
+		case SOCKET_OPTION:
+			path = ctx.argument;
+			break;
+
+		case SIMULATE_OPTION:
+			simulate.boards = 1;
+			break;
+
+		case OPTIONS_EXCESS_ARGUMENT:
+			if (ctx.option == options[SIMULATE_OPTION].long_opt) {
+				char *end;
+				simulate.boards = strtol(ctx.argument, &end, 10);
+				if (*end || simulate.boards < 1 || simulate.boards > 127)
+					throw string("--simulate: number of devices must be from 1-127");
+				break;
+			}
+			throw string("illegal option assignment '") + ctx.argument + '\'';
+
+		case OPTIONS_TERMINATOR:
+			break;
+
+		case OPTIONS_ARGUMENT:
+			throw string("don't know what to do with an argument '") + ctx.option + '\'';
+
+		case OPTIONS_UNKNOWN_OPTION:
+			throw string("unknown option '") + ctx.option + '\'';
+
+		case OPTIONS_MISSING_ARGUMENT:
+			throw string("missing argument for option '") + ctx.option + '\'';
+
+		default:
+			throw string("this can't happen (") + option + '/' + ctx.option + ')';
+		}
+	}
+
+	struct sigaction sa;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sa.sa_handler = interrupt_handler;
+	sigaction(SIGHUP, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGQUIT, &sa, NULL);
+
+	bu0836::transport *t;
+	if (simulate.boards)
+		t = new bu0836::simulator(simulate);
+	else
+		t = new bu0836::libusb_transport;
+	server s(t, path);
+	s.run();
+	return EXIT_SUCCESS;
+
+} catch (const string &msg) {
+	log(ALERT) << "Error: " << msg << endl;
+	return EXIT_FAILURE;
+}
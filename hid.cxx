@@ -16,9 +16,11 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 //
+#include <cctype>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <string>
 
@@ -74,390 +76,60 @@ const char *collection_string(uint32_t id)
 
 
 
-const char *usage_table_string(uint32_t id) // 0x00
+const char *usage_table_string(uint32_t id)
 {
 	if (id >= 0xff00 && id <= 0xffff)
 		return "Vendor-defined";
 
-	switch (id) {
-	case 0x00: return "Undefined";
-	case 0x01: return "Generic Desktop Controls";
-	case 0x02: return "Simulation Controls";
-	case 0x03: return "VR Controls";
-	case 0x04: return "Sport Controls";
-	case 0x05: return "Game Controls";
-	case 0x06: return "Generic Device Controls";
-	case 0x07: return "Keyboard/Keypad";
-	case 0x08: return "LEDs";
-	case 0x09: return "Button";
-	case 0x0a: return "Ordinal";
-	case 0x0b: return "Telephony";
-	case 0x0c: return "Consumer";
-	case 0x0d: return "Digitizer";
-	case 0x0f: return "PID Page";
-	case 0x10: return "Unicode";
-	case 0x14: return "Alphanumeric Display";
-	case 0x40: return "Medical Instruments";
-	case 0x80: case 0x81: case 0x82: case 0x83: return "Monitor pages";
-	case 0x84: case 0x85: case 0x86: case 0x87: return "Power pages";
-	case 0x8c: return "Bar Code Scanner page";
-	case 0x8d: return "Scale page";
-	case 0x8e: return "Magnetic Stripe Reading (MSR) Devices";
-	case 0x8f: return "Reserved Point of Sale pages";
-	case 0x90: return "Camera Control Page";
-	case 0x91: return "Arcade Page";
-	default: return "Reserved";
-	}
+	const char *s = usage_page_name(id);
+	return s ? s : "Reserved";
 }
 
 
 
-const char *generic_desktop_page_string(uint32_t id) // 0x01
+string usage_string(uint32_t page, uint32_t id)
 {
-	switch (id) {
-	case 0x00: return "Undefined";
-	case 0x01: return "Pointer";
-	case 0x02: return "Mouse";
-	case 0x04: return "Joystick";
-	case 0x05: return "Gamepad";
-	case 0x06: return "Keyboard";
-	case 0x07: return "Keypad";
-	case 0x08: return "Multi-axis Controller";
-	case 0x30: return "X";
-	case 0x31: return "Y";
-	case 0x32: return "Z";
-	case 0x33: return "Rx";
-	case 0x34: return "Ry";
-	case 0x35: return "Rz";
-	case 0x36: return "Slider";
-	case 0x37: return "Dial";
-	case 0x38: return "Wheel";
-	case 0x39: return "Hat switch";
-	case 0x3a: return "Counted Buffer";
-	case 0x3b: return "Byte Count";
-	case 0x3c: return "Motion Wakeup";
-	case 0x3d: return "Start";
-	case 0x3e: return "Select";
-	case 0x40: return "Vx";
-	case 0x41: return "Vy";
-	case 0x42: return "Vz";
-	case 0x43: return "Vbrx";
-	case 0x44: return "Vbry";
-	case 0x45: return "Vbrz";
-	case 0x46: return "Vno";
-	case 0x47: return "Feature Notification";
-	case 0x80: return "System Control";
-	case 0x81: return "System Power Down";
-	case 0x82: return "System Sleep";
-	case 0x83: return "System Wake Up";
-	case 0x84: return "System Context Menu";
-	case 0x85: return "System Main Menu";
-	case 0x86: return "System App Menu";
-	case 0x87: return "System Menu Help";
-	case 0x88: return "System Menu Exit";
-	case 0x89: return "System Menu Select";
-	case 0x8a: return "System Menu Right";
-	case 0x8b: return "System Menu Left";
-	case 0x8c: return "System Menu Up";
-	case 0x8d: return "System Menu Down";
-	case 0x8e: return "System Cold Restart";
-	case 0x8f: return "System Warm Restart";
-	case 0x90: return "D-pad Up";
-	case 0x91: return "D-pad Down";
-	case 0x92: return "D-pad Right";
-	case 0x93: return "D-pad Left";
-	case 0xa0: return "System Dock";
-	case 0xa1: return "System Undock";
-	case 0xa2: return "System Setup";
-	case 0xa3: return "System Break";
-	case 0xa4: return "System Debugger Break";
-	case 0xa5: return "Application Break";
-	case 0xa6: return "Application Debugger Break";
-	case 0xa7: return "System Speaker Mute";
-	case 0xa8: return "System Hibernate";
-	case 0xb0: return "System Display Invert";
-	case 0xb1: return "System Display Internal";
-	case 0xb2: return "System Display External";
-	case 0xb3: return "System Display Both";
-	case 0xb4: return "System Display Dual";
-	case 0xb5: return "System Display Toggle Int/Ext";
-	case 0xb6: return "System Display Swap Primary/Secondary";
-	case 0xb7: return "System Display LCD Autoscale";
-	default: return "Reserved";
-	}
-}
-
-
-
-const char *simulation_controls_page_string(uint32_t id) // 0x02
-{
-	switch (id) {
-	case 0x00: return "Undefined";
-	case 0x01: return "Flight Simulation Device";
-	case 0x02: return "Automobile Simulation Device";
-	case 0x03: return "Tank Simulation Device";
-	case 0x04: return "Spaceship Simulation Device";
-	case 0x05: return "Submarine Simulation Device";
-	case 0x06: return "Sailing Simulation Device";
-	case 0x07: return "Motorcycle Simulation Device";
-	case 0x08: return "Sports Simulation Device";
-	case 0x09: return "Airplane Simulation Device";
-	case 0x0a: return "Helicopter Simulation Device";
-	case 0x0b: return "Magic Carpet Simulation Device";
-	case 0x0c: return "Bicycle Simulation Device";
-	case 0x20: return "Flight Control Stick";
-	case 0x21: return "Flight Stick";
-	case 0x22: return "Cyclic Control";
-	case 0x23: return "Cyclic Trim";
-	case 0x24: return "Flight Yoke";
-	case 0x25: return "Track Control";
-	case 0xb0: return "Aileron";
-	case 0xb1: return "Aileron Trim";
-	case 0xb2: return "Anti-Torque Control";
-	case 0xb3: return "Autopilot Enable";
-	case 0xb4: return "Chaff Release";
-	case 0xb5: return "Collective Control";
-	case 0xb6: return "Dive Break";
-	case 0xb7: return "Electronic Countermeasures";
-	case 0xb8: return "Elevator";
-	case 0xb9: return "Elevator Trim";
-	case 0xba: return "Rudder";
-	case 0xbb: return "Throttle";
-	case 0xbc: return "Flight Communications";
-	case 0xbd: return "Flare Release";
-	case 0xbe: return "Landing Gear";
-	case 0xbf: return "Toe Break";
-	case 0xc0: return "Trigger";
-	case 0xc1: return "Weapons Arm";
-	case 0xc2: return "Weapons Select";
-	case 0xc3: return "Wing Flaps";
-	case 0xc4: return "Accelerator";
-	case 0xc5: return "Brake";
-	case 0xc6: return "Clutch";
-	case 0xc7: return "Shifter";
-	case 0xc8: return "Steering";
-	case 0xc9: return "Turret Direction";
-	case 0xca: return "Barrel Elevation";
-	case 0xcb: return "Dive Plane";
-	case 0xcc: return "Ballast";
-	case 0xcd: return "Bicycle Crank";
-	case 0xce: return "Handle Bars";
-	case 0xcf: return "Front Brake";
-	case 0xd0: return "Rear Brake";
-	default: return "Reserved";
-	}
-}
-
-
-
-const char *vr_controls_page_string(uint32_t id)
-{
-	switch (id) {
-	case 0x00: return "Undefined";
-	case 0x01: return "Belt";
-	case 0x02: return "Body Suit";
-	case 0x03: return "Flexor";
-	case 0x04: return "Glove";
-	case 0x05: return "Head Tracker";
-	case 0x06: return "Head Mounted Display";
-	case 0x07: return "Hand Tracker";
-	case 0x08: return "Oculometer";
-	case 0x09: return "Vest";
-	case 0x0a: return "Animatronic Device";
-	case 0x20: return "Stereo Enable";
-	case 0x21: return "Display Enable";
-	default: return "Reserved";
-	}
-}
-
-
-
-const char *sport_controls_page_string(uint32_t id)
-{
-	switch (id) {
-	case 0x00: return "Undefined";
-	case 0x01: return "Baseball Bat";
-	case 0x02: return "Golf Club";
-	case 0x03: return "Rowing Machine";
-	case 0x04: return "Treadmill";
-	case 0x30: return "Oar";
-	case 0x31: return "Slope";
-	case 0x32: return "Rate";
-	case 0x33: return "Stick Speed";
-	case 0x34: return "Stick Face Angle";
-	case 0x35: return "Stick Heel/Toe";
-	case 0x36: return "Stick Follow Through";
-	case 0x37: return "Stick Tempo";
-	case 0x38: return "Stick Type";
-	case 0x39: return "Stick Height";
-	case 0x50: return "Putter";
-	case 0x51: return "1 Iron";
-	case 0x52: return "2 Iron";
-	case 0x53: return "3 Iron";
-	case 0x54: return "4 Iron";
-	case 0x55: return "5 Iron";
-	case 0x56: return "6 Iron";
-	case 0x57: return "7 Iron";
-	case 0x58: return "8 Iron";
-	case 0x59: return "9 Iron";
-	case 0x5a: return "10 Iron";
-	case 0x5b: return "11 Iron";
-	case 0x5c: return "Sand Wedge";
-	case 0x5d: return "Loft Wedge";
-	case 0x5e: return "Power Wedge";
-	case 0x5f: return "1 Wood";
-	case 0x60: return "3 Wood";
-	case 0x61: return "5 Wood";
-	case 0x62: return "7 Wood";
-	case 0x63: return "9 Wood";
-	default: return "Reserved";
-	}
-}
-
-
-
-const char *game_controls_page_string(uint32_t id)
-{
-	switch (id) {
-	case 0x00: return "Undefined";
-	case 0x01: return "3D Game Controller";
-	case 0x02: return "Pinball Device";
-	case 0x03: return "Gun Device";
-	case 0x20: return "Point of View";
-	case 0x21: return "Turn Right/Left";
-	case 0x22: return "Pitch Forward/Backward";
-	case 0x23: return "Roll Right/Left";
-	case 0x24: return "Move Right/Left";
-	case 0x25: return "Move Forward/Backward";
-	case 0x26: return "Move Up/Down";
-	case 0x27: return "Lean Right/Left";
-	case 0x28: return "Lean Forward/Backward";
-	case 0x29: return "Height of POV";
-	case 0x2a: return "Flipper";
-	case 0x2b: return "Secondary Flipper";
-	case 0x2c: return "Bump";
-	case 0x2d: return "New Game";
-	case 0x2e: return "Shoot Ball";
-	case 0x2f: return "Player";
-	case 0x30: return "Gun Bolt";
-	case 0x31: return "Gun Clip";
-	case 0x32: return "Gun Selectory";
-	case 0x33: return "Gun Single Shot";
-	case 0x34: return "Gun Burst";
-	case 0x35: return "Gun Automatic";
-	case 0x36: return "Gun Safety";
-	case 0x37: return "Gamepad Fire/Jump";
-	case 0x39: return "Gamepad Trigger";
-	default: return "Reserved";
-	}
-}
-
-
-
-const char *generic_device_controls_page_string(uint32_t id)
-{
-	switch (id) {
-	case 0x00: return "Undefined";
-	case 0x20: return "Battery Strength";
-	case 0x21: return "Wireless Channel";
-	case 0x22: return "Wireless ID";
-	default: return "Reserved";
-	}
-}
-
-
-
-const char *keyboard_keypad_page_string(uint32_t id)
-{
-	switch (id) {
-	case 0x00: return "Undefined";
-	case 0x01: return "Keyboard ErrorRollOver";
-	case 0x02: return "Keyboard POSTFail";
-	case 0x03: return "Keyboard ErrorUndefined";
-	case 0x04: return "Keyboard a and A";
-	case 0x05: return "Keyboard b and B";
-	case 0x06: return "Keyboard c and C";
-	case 0x07: return "Keyboard d and D";
-	case 0x08: return "Keyboard e and E";
-	case 0x09: return "Keyboard f and F";
-	case 0x0a: return "Keyboard g and G";
-	case 0x0b: return "Keyboard h and H";
-	case 0x0c: return "Keyboard i and I";
-	case 0x0d: return "Keyboard j and J";
-	case 0x0e: return "Keyboard k and K";
-	case 0x0f: return "Keyboard l and L";
-	case 0x10: return "Keyboard m and M";
-	case 0x11: return "Keyboard n and N";
-	case 0x12: return "Keyboard o and O";
-	case 0x13: return "Keyboard p and P";
-	case 0x14: return "Keyboard q and Q";
-	case 0x15: return "Keyboard r and R";
-	case 0x16: return "Keyboard s and S";
-	case 0x17: return "Keyboard t and T";
-	case 0x18: return "Keyboard u and U";
-	case 0x19: return "Keyboard v and V";
-	case 0x1a: return "Keyboard w and W";
-	case 0x1b: return "Keyboard x and X";
-	case 0x1c: return "Keyboard y and Y";
-	case 0x1d: return "Keyboard z and Z";
-	case 0x1e: return "Keyboard 1 and !";
-	case 0x1f: return "Keyboard 2 and @";
-	case 0x20: return "Keyboard 3 and #";
-	case 0x21: return "Keyboard 4 and $";
-	case 0x22: return "Keyboard 5 and %";
-	case 0x23: return "Keyboard 6 and ^";
-	case 0x24: return "Keyboard 7 and &";
-	case 0x25: return "Keyboard 8 and *";
-	case 0x26: return "Keyboard 9 and (";
-	case 0x27: return "Keyboard 0 and )";
-	case 0x28: return "Keyboard Return";
-	case 0x29: return "Keyboard Escape";
-	case 0x2a: return "Keyboard Delete (Backspace)";
-	case 0x2b: return "Keyboard Tab";
-	case 0x2c: return "Keyboard Spacebar";
-	case 0x2d: return "Keyboard - and _";
-	case 0x2e: return "Keyboard = and +";
-	case 0x2f: return "Keyboard [ and {";
-	case 0x30: return "Keyboard ] and }";
-	case 0x31: return "Keyboard \\ and |";
-	case 0x32: return "Keyboard Non-US # and ~";
-	case 0x33: return "Keyboard ; and :";
-	case 0x34: return "Keyboard ' and \"";
-	case 0x35: return "Keyboard Grave Accent and Tilde";
-	case 0x36: return "Keyboard , and <";
-	case 0x37: return "Keyboard . and >";
-	case 0x38: return "Keyboard / and ?";
-	case 0x39: return "Keyboard Caps Lock";
-	case 0x3a: return "Keyboard F1";
-	case 0x3b: return "Keyboard F2";
-	case 0x3c: return "Keyboard F3";
-	case 0x3d: return "Keyboard F4";
-	case 0x3e: return "Keyboard F5";
-	case 0x3f: return "Keyboard F6";
-	case 0x40: return "Keyboard F7";
-	case 0x41: return "Keyboard F8";
-	case 0x42: return "Keyboard F9";
-	case 0x43: return "Keyboard F10";
-	case 0x44: return "Keyboard F11";
-	case 0x45: return "Keyboard F12";
-	default: return "Reserved";
+	const char *s = usage_name(page, id);
+	if (s)
+		return s;
+
+	ostringstream x;
+	switch (page) {
+	case 0x09:
+		if (!id)
+			return "No Button Pressed";
+		x << "Button " << id;
+		return x.str();
+	case 0x0a:
+		if (!id)
+			return "Reserved";
+		x << "Instance " << id;
+		return x.str();
+	case 0x10:
+		x << "U+" << hex << uppercase << setw(4) << setfill('0') << id;
+		return x.str();
+	default:
+		return usage_page_name(page) ? "Reserved" : "?????";
 	}
 }
 
 
 
-const char *usage_string(uint32_t usage, uint32_t id)
+// "Button 12" -> "button_12", "Keyboard ' and \"" -> "keyboard_and"
+string c_identifier(const string &s)
 {
-	switch (usage) {
-	case 0x1: return generic_desktop_page_string(id);
-	case 0x2: return simulation_controls_page_string(id);
-	case 0x3: return vr_controls_page_string(id);
-	case 0x4: return sport_controls_page_string(id);
-	case 0x5: return game_controls_page_string(id);
-	case 0x6: return generic_device_controls_page_string(id);
-	case 0x7: return keyboard_keypad_page_string(id);
-	default: return "?????";
+	string id;
+	for (string::const_iterator it = s.begin(); it != s.end(); ++it) {
+		if (isalnum(*it))
+			id += tolower(*it);
+		else if (!id.empty() && id[id.size() - 1] != '_')
+			id += '_';
 	}
+	while (!id.empty() && id[id.size() - 1] == '_')
+		id.resize(id.size() - 1);
+	if (!id.empty() && isdigit(id[0]))
+		id = '_' + id;
+	return id;
 }
 
 
@@ -550,67 +222,93 @@ string unit_string(uint32_t u)
 
 	i = (u >>= 4) & 0x0f; // nibble 7
 	if (i)
-		log(WARN) << "use of reserved unit nibble 7" << endl;
+		LOG(WARN) << "use of reserved unit nibble 7" << endl;
 
 	return v.empty() ? string("None") : string_join(v);
 }
 
 
 
-hid_main_item::hid_main_item(main_type t, uint32_t dt, hid_main_item *p, hid_global_data &g,
-		hid_local_data &l, int &bitpos) :
-	_type(t),
-	_data_type(dt),
-	_parent(p),
-	_global(g),
-	_local(l)
+string hid_value::name() const
 {
-	size_t usize = _local.usage.size();
-	for (uint32_t i = 0; i < _global.report_count; i++) {
-		uint32_t usage = ~0u;
-		std::string ustr;
+	if (_named)
+		return usage_string(_usage_page, _usage);
 
-		if (i < usize) {
-			usage = _local.usage[i];
-			ustr = usage_string(_global.usage_table, usage);
-		} else {
-			usage = _local.usage_minimum + i;
-			ostringstream x;
-			x << '#' << usage;
-			ustr = x.str();
-		}
+	ostringstream x;
+	x << '#' << _usage;
+	return x.str();
+}
 
-		if (_global.report_size) {
-			_values.push_back(hid_value(this, usage, ustr, bitpos, _global.report_size));
-			bitpos += _global.report_size;
-		} else {
-			log(WARN) << "data field with zero width" << endl;
-		}
-	}
+
+
+hid::hid() : _shared_global(0), _shared_local(0), _bitpos(0), _depth(0)
+{
+	_items.push_back(hid_main_item(ROOT, 0, -1, shared_global(), shared_local(), 0, 0));
+	_item_stack.push_back(0);
 }
 
 
 
-hid_main_item::~hid_main_item()
+// Items only get pointers to pooled copies of the parser state. Most items
+// share them with their predecessor, so the pool is only searched after the
+// state was changed by a global/local item.
+const hid_global_data *hid::shared_global()
 {
-	vector<hid_main_item *>::const_iterator it, end = _children.end();
-	for (it = _children.begin(); it != end; ++it)
-		delete *it;
+	if (!_shared_global) {
+		deque<hid_global_data>::const_reverse_iterator it, end = _global_pool.rend();
+		for (it = _global_pool.rbegin(); it != end; ++it)
+			if (*it == _global)
+				return _shared_global = &*it;
+
+		_global_pool.push_back(_global);
+		_shared_global = &_global_pool.back();
+	}
+	return _shared_global;
 }
 
 
 
-hid::hid() : _item(0), _bitpos(0), _depth(0)
+const hid_local_data *hid::shared_local()
 {
-	_item = new hid_main_item(ROOT, 0, 0, _global, _local, _bitpos);
-	_item_stack.push_back(_item);
+	if (!_shared_local) {
+		deque<hid_local_data>::const_reverse_iterator it, end = _local_pool.rend();
+		for (it = _local_pool.rbegin(); it != end; ++it)
+			if (*it == _local)
+				return _shared_local = &*it;
+
+		_local_pool.push_back(_local);
+		_shared_local = &_local_pool.back();
+	}
+	return _shared_local;
 }
 
 
 
-hid::~hid()
+unsigned int hid::add_item(main_type type, uint32_t data_type)
 {
-	delete _item;
+	unsigned int index = _items.size();
+	_items.push_back(hid_main_item(type, data_type, _item_stack.back(), shared_global(), shared_local(),
+			index, _values.size()));
+
+	size_t usize = _local.usage.size();
+	for (uint32_t i = 0; i < _global.report_count; i++) {
+		bool named = i < usize;
+		uint32_t usage = named ? _local.usage[i] : _local.usage_minimum + i;
+
+		if (_global.report_size) {
+			_values.push_back(hid_value(_global.usage_table, usage, named, _bitpos, _global.report_size));
+			_bitpos += _global.report_size;
+		} else {
+			LOG(WARN) << "data field with zero width" << endl;
+		}
+	}
+	_items[index]._end_value = _values.size();
+
+	// extend all open collections (and the root)
+	vector<unsigned int>::const_iterator it, end = _item_stack.end();
+	for (it = _item_stack.begin(); it != end; ++it)
+		_items[*it]._end = index + 1;
+	return index;
 }
 
 
@@ -622,7 +320,7 @@ void hid::parse(const unsigned char *data, int len)
 			int size = *++d;
 			/*int tag = * */++d;
 
-			log(ALERT) << ORIGIN"skipping unsupported long item" << endl;
+			LOG(ALERT) << ORIGIN"skipping unsupported long item" << endl;
 			d += size;
 
 		} else {          // short item
@@ -630,7 +328,7 @@ void hid::parse(const unsigned char *data, int len)
 			if (size == 3)
 				size++;
 
-			log(BULK) << dec << setw(3) << d - data << ": " << bold << black << bytes(d, 1 + size, 19) << reset;
+			LOG(BULK) << dec << setw(3) << d - data << ": " << bold << black << bytes(d, 1 + size, 19) << reset;
 
 			int type = (*d >> 2) & 0x3;
 			int tag = (*d++ >> 4) & 0xf;
@@ -644,9 +342,9 @@ void hid::parse(const unsigned char *data, int len)
 				value |= *d++ << 16, value |= *d++ << 24;
 
 			if (type == 0) {        // Main
-				log(BULK) << magenta;
+				LOG(BULK) << magenta;
 				do_main(tag, value);
-				log(BULK) << reset << endl;
+				LOG(BULK) << reset << endl;
 
 			} else if (type == 1) { // Global
 				int32_t svalue = 0; // some vars expect signed values
@@ -657,124 +355,123 @@ void hid::parse(const unsigned char *data, int len)
 				else if (size == 4)
 					svalue = int32_t(value);
 
-				log(BULK) << _indent << brown; // TODO decode usage page/usage combination (?)
+				LOG(BULK) << _indent << brown; // TODO decode usage page/usage combination (?)
 				do_global(tag, value, svalue);
-				log(BULK) << reset << endl;
+				LOG(BULK) << reset << endl;
 
 			} else if (type == 2) { // Local
-				log(BULK) << _indent << cyan;
+				LOG(BULK) << _indent << cyan;
 				do_local(tag, value);
-				log(BULK) << reset << endl;
+				LOG(BULK) << reset << endl;
 
 			} else {                // Reserved
-				log(BULK) << _indent << bold << red << "Reserved" << reset << endl;
-				log(ALERT) << ORIGIN"short item: skipping item of reserved type" << endl;
+				LOG(BULK) << _indent << bold << red << "Reserved" << reset << endl;
+				LOG(ALERT) << ORIGIN"short item: skipping item of reserved type" << endl;
 			}
 		}
 	}
-	log(BULK) << endl;
+	LOG(BULK) << endl;
 }
 
 
 
 void hid::do_main(int tag, uint32_t value)
 {
-	hid_main_item *current = _item_stack[_item_stack.size() - 1];
 	switch (tag) {
 	case 0x8:   // Input
-		log(BULK) << _indent << "Input " << input_output_feature_string(INPUT, value);
-		current->children().push_back(new hid_main_item(INPUT, value, current, _global, _local, _bitpos));
+		LOG(BULK) << _indent << "Input " << input_output_feature_string(INPUT, value);
+		add_item(INPUT, value);
 		break;
 	case 0x9:   // Output
-		log(BULK) << _indent << "Output " << input_output_feature_string(OUTPUT, value);
-		current->children().push_back(new hid_main_item(OUTPUT, value, current, _global, _local, _bitpos));
+		LOG(BULK) << _indent << "Output " << input_output_feature_string(OUTPUT, value);
+		add_item(OUTPUT, value);
 		break;
 	case 0xb:   // Feature
-		log(BULK) << _indent << "Feature " << input_output_feature_string(FEATURE, value);
-		current->children().push_back(new hid_main_item(FEATURE, value, current, _global, _local, _bitpos));
+		LOG(BULK) << _indent << "Feature " << input_output_feature_string(FEATURE, value);
+		add_item(FEATURE, value);
 		break;
 	case 0xa: { // Collection
-			log(BULK) << _indent << "Collection '" << collection_string(value) << '\'';
+			LOG(BULK) << _indent << "Collection '" << collection_string(value) << '\'';
 			_indent.assign(++_depth, '\t');
-			hid_main_item *collection = new hid_main_item(COLLECTION, value, current, _global, _local, _bitpos);
-			current->children().push_back(collection);
-			_item_stack.push_back(collection);
+			_item_stack.push_back(add_item(COLLECTION, value));
 		}
 		break;
 	case 0xc: // End Collection
 		if (_depth) {
 			_indent.assign(--_depth, '\t');
-			log(BULK) << _indent << "End Collection ";
+			LOG(BULK) << _indent << "End Collection ";
 			_item_stack.pop_back();
 		} else {
-			log(ALERT) << "ignoring excess 'End Collection'" << endl;
+			LOG(ALERT) << "ignoring excess 'End Collection'" << endl;
 		}
 		break;
 	}
 	_local.reset();
+	_shared_local = 0;
 }
 
 
 
 void hid::do_global(int tag, uint32_t value, int32_t svalue)
 {
+	_shared_global = 0;
 	switch (tag) {
 	case 0x0:
-		log(BULK) << "Usage Page '" << usage_table_string(value) << '\'';
+		LOG(BULK) << "Usage Page '" << usage_table_string(value) << '\'';
 		_global.usage_table = value;
 		return;
 	case 0x1:
-		log(BULK) << "Logical Minimum = " << svalue;
+		LOG(BULK) << "Logical Minimum = " << svalue;
 		_global.logical_minimum = svalue;
 		return;
 	case 0x2:
-		log(BULK) << "Logical Maximum = " << svalue;
+		LOG(BULK) << "Logical Maximum = " << svalue;
 		_global.logical_maximum = svalue;
 		return;
 	case 0x3:
-		log(BULK) << "Physical Minimum = " << svalue;
+		LOG(BULK) << "Physical Minimum = " << svalue;
 		_global.physical_minimum = svalue;
 		return;
 	case 0x4:
-		log(BULK) << "Physical Maximum = " << svalue;
+		LOG(BULK) << "Physical Maximum = " << svalue;
 		_global.physical_maximum = svalue;
 		return;
 	case 0x5:
-		log(BULK) << "Unit Exponent = " << svalue;
+		LOG(BULK) << "Unit Exponent = " << svalue;
 		_global.unit_exponent = svalue;
 		_global.unit_exponent_factor = pow(10, svalue);
 		return;
 	case 0x6:
-		log(BULK) << "Unit = " << unit_string(value);
+		LOG(BULK) << "Unit = " << unit_string(value);
 		_global.unit = value;
 		return;
 	case 0x7:
-		log(BULK) << "Report Size = " << value;
+		LOG(BULK) << "Report Size = " << value;
 		_global.report_size = value;
 		return;
 	case 0x8:
-		log(BULK) << "Report ID = " << value;
+		LOG(BULK) << "Report ID = " << value;
 		_global.report_id = value;
 		return;
 	case 0x9:
-		log(BULK) << "Report Count = " << value;
+		LOG(BULK) << "Report Count = " << value;
 		_global.report_count = value;
 		return;
 	case 0xa:
-		log(BULK) << "Push";
+		LOG(BULK) << "Push";
 		_data_stack.push_back(_global);
 		return;
 	case 0xb:
-		log(BULK) << "Pop";
+		LOG(BULK) << "Pop";
 		if (_data_stack.empty()) {
-			log(ALERT) << ORIGIN"can't pop -- stack empty" << endl;
+			LOG(ALERT) << ORIGIN"can't pop -- stack empty" << endl;
 		} else {
 			_global = _data_stack[_data_stack.size() - 1];
 			_data_stack.pop_back();
 		}
 		return;
 	default:
-		log(WARN) << ORIGIN"skipping reserved global item" << endl;
+		LOG(WARN) << ORIGIN"skipping reserved global item" << endl;
 	}
 }
 
@@ -782,97 +479,307 @@ void hid::do_global(int tag, uint32_t value, int32_t svalue)
 
 void hid::do_local(int tag, uint32_t value)
 {
+	_shared_local = 0;
 	switch (tag) {
 	case 0x0:
 		if (_global.usage_table >= 0xff00 && _global.usage_table <= 0xffff) // vendor defined
-			log(BULK) << "Usage " << value;
+			LOG(BULK) << "Usage " << value;
 		else
-			log(BULK) << "Usage '" << usage_string(_global.usage_table, value) << '\'';
+			LOG(BULK) << "Usage '" << usage_string(_global.usage_table, value) << '\'';
 		_local.usage.push_back(value);
 		return;
 	case 0x1:
-		log(BULK) << "Usage Minimum";
+		LOG(BULK) << "Usage Minimum";
 		_local.usage_minimum = value;
 		break;
 	case 0x2:
-		log(BULK) << "Usage Maximum";
+		LOG(BULK) << "Usage Maximum";
 		_local.usage_maximum = value;
 		break;
 	case 0x3:
-		log(BULK) << "Designator Index";
+		LOG(BULK) << "Designator Index";
 		_local.designator_index = value;
 		break;
 	case 0x4:
-		log(BULK) << "Designator Minimum";
+		LOG(BULK) << "Designator Minimum";
 		_local.designator_minimum = value;
 		break;
 	case 0x5:
-		log(BULK) << "Designator Maximum";
+		LOG(BULK) << "Designator Maximum";
 		_local.designator_maximum = value;
 		break;
 	case 0x6:
-		log(BULK) << "???";
+		LOG(BULK) << "???";
 		break;
 	case 0x7:
-		log(BULK) << "String Index";
+		LOG(BULK) << "String Index";
 		_local.string_index = value;
 		break;
 	case 0x8:
-		log(BULK) << "String Minimum";
+		LOG(BULK) << "String Minimum";
 		_local.string_minimum = value;
 		break;
 	case 0x9:
-		log(BULK) << "String Maximum";
+		LOG(BULK) << "String Maximum";
 		_local.string_maximum = value;
 		break;
 	case 0xa:
-		log(BULK) << "Delimiter";
+		LOG(BULK) << "Delimiter";
 		_local.delimiter = value;
 		break;
 	default:
-		log(BULK) << "Reserved";
+		LOG(BULK) << "Reserved";
 		break;
 	}
-	log(BULK) << " = " << value;
+	LOG(BULK) << " = " << value;
 }
 
 
 
-void hid::print_input_report(hid_main_item *item, const unsigned char *data)
+void hid::print_input_report(const unsigned char *data) const
 {
-	vector<hid_main_item *>::const_iterator it, end = item->children().end();
-	for (it = item->children().begin(); it != end; ++it)
-		print_input_report(*it, data);
+	vector<hid_main_item>::const_iterator item, end = _items.end();
+	for (item = _items.begin(); item != end; ++item) {
+		if (item->type() != INPUT)
+			continue;
 
-	if (item->type() != INPUT)
-		return;
+		if (item->data_type() & 1)    // padding constant
+			continue;
 
-	if (item->data_type() & 1)    // padding constant
-		return;
+		const hid_global_data &global = item->global();
+		uint32_t colltype = item->parent() >= 0 ? _items[item->parent()].data_type() : 0;
 
-	const hid_global_data global = item->global();
-	const hid_local_data local = item->local();
-	uint32_t colltype = item->parent() ? item->parent()->data_type() : 0;
+		for (unsigned int i = item->first_value(); i < item->end_value(); i++) {
+			const hid_value &val = _values[i];
+			cout << bold << black << val.name() << "=" << reset;
 
-	vector<hid_value>::const_iterator val, vend = item->values().end();
-	for (val = item->values().begin(); val != vend; ++val) {
-		cout << bold << black << val->name() << "=" << reset;
+			uint32_t v = val.get_unsigned(data);
 
-		uint32_t v = val->get_unsigned(data);
+			if (global.report_size == 1) {
+				cout << (v ? red : green) << v << reset;
 
-		if (global.report_size == 1) {
-			cout << (v ? red : green) << v << reset;
+			} else if (colltype == 0) { // physical (i.e. axes)
+				double norm = double(v) / global.logical_maximum;
+				cout << cyan << v << reset << setprecision(5) << " (" << magenta << norm << reset << ')';
 
-		} else if (colltype == 0) { // physical (i.e. axes)
-			double norm = double(v) / global.logical_maximum;
-			cout << cyan << v << reset << setprecision(5) << " (" << magenta << norm << reset << ')';
+			} else {
+				cout << brown << v << " (" << val.get_signed(data) << ')' << reset << endl;
+			}
+			cout << ' ';
+		}
+		cout << endl;
+	}
+}
 
-		} else {
-			cout << brown << v << " (" << val->get_signed(data) << ')' << reset << endl;
+
+
+
+// Reads a field one bit at a time -- deliberately not with the 8 byte load and
+// shift that get_unsigned() and the generated decoder use, so that a mistake
+// in those can't cancel out when they are compared against it.
+uint32_t extract_bits(const unsigned char *data, unsigned int offset, unsigned int width)
+{
+	uint32_t v = 0;
+	for (unsigned int b = 0; b < width && b < 32; b++) {
+		unsigned int bit = offset + b;
+		v |= uint32_t(data[bit / 8] >> bit % 8 & 1) << b;
+	}
+	return v;
+}
+
+
+
+struct decoder_field {
+	string id;      // member name in the generated state struct
+	string ID;      // prefix of the generated constants
+	const hid_value *value;
+	bool is_signed;
+};
+
+
+
+// Writes a C++ header that decodes input reports of exactly this layout
+// with constant offsets and masks. The reports are embedded as test data,
+// with the values that the runtime decoder (get_unsigned/get_signed) got for
+// them, which are checked against a bit-by-bit extraction before anything is
+// written. Returns 0 on success, -1 for unsupported layouts or mismatches.
+int hid::write_decoder(ostream &os, const string &title, const vector<vector<unsigned char> > &reports) const
+{
+	vector<decoder_field> fields;
+	set<string> ids;
+	unsigned int report_bits = 0;
+
+	vector<hid_main_item>::const_iterator item, end = _items.end();
+	for (item = _items.begin(); item != end; ++item) {
+		if (item->global().report_id) {
+			log(ALERT) << "write_decoder: descriptors with report IDs aren't supported" << endl;
+			return -1;
+		}
+		if (item->type() != INPUT)
+			continue;
+
+		for (unsigned int i = item->first_value(); i < item->end_value(); i++) {
+			const hid_value &val = _values[i];
+			unsigned int bits = val.offset() + val.width();
+			if (bits > report_bits)
+				report_bits = bits;
+			if (item->data_type() & 1) // padding constant
+				continue;
+
+			decoder_field f;
+			f.value = &val;
+			f.is_signed = item->global().logical_minimum < 0;
+			f.id = c_identifier(val.usage_page() >= 0xff00 ? string("vendor_") + val.usage()
+					: usage_string(val.usage_page(), val.usage()));
+			if (f.id.empty() || f.id == "reserved")
+				f.id = string("field_") + int(fields.size());
+			string base = f.id;
+			for (int n = 2; ids.count(f.id); n++)
+				f.id = base + '_' + n;
+			ids.insert(f.id);
+			f.ID = f.id;
+			for (string::iterator it = f.ID.begin(); it != f.ID.end(); ++it)
+				*it = toupper(*it);
+			fields.push_back(f);
+		}
+	}
+	if (fields.empty()) {
+		log(ALERT) << "write_decoder: no input fields" << endl;
+		return -1;
+	}
+
+	unsigned int report_size = (report_bits + 7) / 8;
+	for (size_t r = 0; r < reports.size(); r++) {
+		if (reports[r].size() < report_size + REPORT_PADDING) {
+			log(ALERT) << "write_decoder: short test report " << r << endl;
+			return -1;
+		}
+		const unsigned char *data = &reports[r][0];
+		for (size_t i = 0; i < fields.size(); i++) {
+			const hid_value &v = *fields[i].value;
+			uint32_t mask = v.width() >= 32 ? ~0u : (1u << v.width()) - 1;
+			uint32_t bits = extract_bits(data, v.offset(), v.width());
+			uint32_t sign = (mask >> 1) + 1;
+			if (fields[i].is_signed)
+				bits = (bits ^ sign) - sign;
+			uint32_t runtime = fields[i].is_signed ? uint32_t(v.get_signed(data)) : v.get_unsigned(data);
+			if (bits != runtime) {
+				log(ALERT) << "write_decoder: " << fields[i].id << " in test report " << r
+						<< " decodes to " << runtime << " instead of " << bits << endl;
+				return -1;
+			}
+		}
+	}
+
+	string guard = c_identifier(title);
+	for (string::iterator it = guard.begin(); it != guard.end(); ++it)
+		*it = toupper(*it);
+	guard = "BU0836_DECODER_" + guard + "_H";
+
+	os << "// input report decoder for " << title << endl;
+	os << "// generated by bu0836 --emit-decoder -- do not edit" << endl;
+	os << "//" << endl;
+	os << "// decode() reads every field with one 8 byte load, so report buffers have to" << endl;
+	os << "// stay readable for REPORT_PADDING bytes past the end of the report." << endl;
+	os << "#ifndef " << guard << endl;
+	os << "#define " << guard << endl;
+	os << endl;
+	os << "#include <stdint.h>" << endl;
+	os << "#include <string.h>" << endl;
+	os << endl;
+	os << "namespace bu0836_decoder {" << endl;
+	os << endl;
+	os << "static const unsigned int REPORT_SIZE = " << report_size << ";" << endl;
+	os << "static const unsigned int REPORT_PADDING = " << int(REPORT_PADDING) << ";" << endl;
+	os << endl;
+	os << "// byte offset, shift and mask of each field" << endl;
+	for (size_t i = 0; i < fields.size(); i++) {
+		const hid_value &v = *fields[i].value;
+		const string &id = fields[i].ID;
+		uint32_t mask = v.width() >= 32 ? ~0u : (1u << v.width()) - 1;
+		os << "static const unsigned int " << id << "_BYTE = " << v.offset() / 8 << ";" << endl;
+		os << "static const unsigned int " << id << "_SHIFT = " << v.offset() % 8 << ";" << endl;
+		os << "static const uint32_t " << id << "_MASK = 0x" << hex << mask << dec << "u;" << endl;
+	}
+	os << endl;
+	os << "struct state {" << endl;
+	for (size_t i = 0; i < fields.size(); i++) {
+		const hid_value &v = *fields[i].value;
+		os << '\t' << (fields[i].is_signed ? "int32_t " : "uint32_t ") << fields[i].id << ";"
+				<< " // " << v.name() << ", " << v.width() << " bit at bit " << v.offset() << endl;
+	}
+	os << "};" << endl;
+	os << endl;
+	os << "inline uint64_t load_le64(const uint8_t *d)" << endl;
+	os << "{" << endl;
+	os << "\tuint64_t v;" << endl;
+	os << "\tmemcpy(&v, d, sizeof(v));" << endl;
+	os << "#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__" << endl;
+	os << "\tv = __builtin_bswap64(v);" << endl;
+	os << "#endif" << endl;
+	os << "\treturn v;" << endl;
+	os << "}" << endl;
+	os << endl;
+	os << "inline void decode(const uint8_t *report, state &s)" << endl;
+	os << "{" << endl;
+	for (size_t i = 0; i < fields.size(); i++) {
+		const string &id = fields[i].id, &ID = fields[i].ID;
+		string expr = "uint32_t(load_le64(report + " + ID + "_BYTE) >> " + ID + "_SHIFT) & " + ID + "_MASK";
+		if (fields[i].is_signed)
+			os << "\ts." << id << " = int32_t(((" << expr << ") ^ ((" << ID << "_MASK >> 1) + 1)) - ((" << ID
+					<< "_MASK >> 1) + 1));" << endl;
+		else
+			os << "\ts." << id << " = " << expr << ";" << endl;
+	}
+	os << "}" << endl;
+	os << endl;
+
+	// recorded reports and the runtime decoder's results
+	os << "static const unsigned int TEST_REPORTS = " << reports.size() << ";" << endl;
+	if (!reports.empty()) {
+		os << "static const uint8_t test_report[TEST_REPORTS][REPORT_SIZE + REPORT_PADDING] = {" << endl;
+		for (size_t r = 0; r < reports.size(); r++) {
+			os << "\t{";
+			for (unsigned int i = 0; i < report_size + REPORT_PADDING; i++)
+				os << (i ? ", " : " ") << "0x" << hex << setw(2) << setfill('0')
+						<< int(i < report_size ? reports[r][i] : 0) << dec << setfill(' ');
+			os << " }," << endl;
 		}
-		cout << ' ';
+		os << "};" << endl;
+		os << "static const uint32_t test_expected[TEST_REPORTS][" << fields.size() << "] = {" << endl;
+		for (size_t r = 0; r < reports.size(); r++) {
+			os << "\t{";
+			for (size_t i = 0; i < fields.size(); i++) {
+				const hid_value &v = *fields[i].value;
+				uint32_t x = fields[i].is_signed ? uint32_t(v.get_signed(&reports[r][0]))
+						: v.get_unsigned(&reports[r][0]);
+				os << (i ? ", " : " ") << "0x" << hex << x << dec << 'u';
+			}
+			os << " }," << endl;
+		}
+		os << "};" << endl;
+	}
+	os << endl;
+	os << "// checks decode() against the values bu0836 decoded at runtime" << endl;
+	os << "inline bool selftest()" << endl;
+	os << "{" << endl;
+	if (!reports.empty()) {
+		os << "\tfor (unsigned int i = 0; i < TEST_REPORTS; i++) {" << endl;
+		os << "\t\tstate s;" << endl;
+		os << "\t\tdecode(test_report[i], s);" << endl;
+		os << "\t\tconst uint32_t *e = test_expected[i];" << endl;
+		for (size_t i = 0; i < fields.size(); i++)
+			os << "\t\tif (uint32_t(s." << fields[i].id << ") != e[" << i << "])" << endl
+					<< "\t\t\treturn false;" << endl;
+		os << "\t}" << endl;
 	}
-	cout << endl;
+	os << "\treturn true;" << endl;
+	os << "}" << endl;
+	os << endl;
+	os << "} // namespace bu0836_decoder" << endl;
+	os << endl;
+	os << "#endif" << endl;
+	return os.good() ? 0 : -1;
 }
 
 } // namespace hid
@@ -19,6 +19,9 @@
 #ifndef _HID_PARSER_HXX_
 #define _HID_PARSER_HXX_
 
+#include <cstring>
+#include <deque>
+#include <iosfwd>
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -27,6 +30,13 @@
 
 namespace hid {
 
+// usage name tables (hid_usages.cxx, generated from hid_usages.txt);
+// both return 0 for unknown pages/usages
+const char *usage_page_name(uint32_t page);
+const char *usage_name(uint32_t page, uint32_t id);
+
+
+
 struct hid_global_data {
 	hid_global_data() :
 		usage_table(0),
@@ -49,6 +59,7 @@ struct hid_global_data {
 		bool undefined() const { return !_defined; }
 		int32_t operator=(int32_t v) { _defined = true; return _value = v; }
 		int32_t operator()(void) const { return _value; }
+		bool operator==(const undef &u) const { return _value == u._value && _defined == u._defined; }
 
 	private:
 		int32_t _value;
@@ -67,6 +78,14 @@ struct hid_global_data {
 	uint32_t report_count;
 
 	double unit_exponent_factor;
+
+	bool operator==(const hid_global_data &g) const {
+		return usage_table == g.usage_table && logical_minimum == g.logical_minimum
+				&& logical_maximum == g.logical_maximum && physical_minimum == g.physical_minimum
+				&& physical_maximum == g.physical_maximum && unit_exponent == g.unit_exponent
+				&& unit == g.unit && report_size == g.report_size && report_id == g.report_id
+				&& report_count == g.report_count; // unit_exponent_factor follows unit_exponent
+	}
 };
 
 
@@ -81,6 +100,14 @@ struct hid_local_data {
 				= string_maximum = delimiter = 0;
 	}
 
+	bool operator==(const hid_local_data &l) const {
+		return usage_minimum == l.usage_minimum && usage_maximum == l.usage_maximum
+				&& designator_index == l.designator_index && designator_minimum == l.designator_minimum
+				&& designator_maximum == l.designator_maximum && string_index == l.string_index
+				&& string_minimum == l.string_minimum && string_maximum == l.string_maximum
+				&& delimiter == l.delimiter && usage == l.usage;
+	}
+
 	std::vector<uint32_t> usage;
 	uint32_t usage_minimum;
 	uint32_t usage_maximum;
@@ -101,84 +128,106 @@ enum main_type {
 
 
 
-class hid_main_item;
+// Fields are read with one unaligned 8 byte load, so report buffers have to
+// stay readable for REPORT_PADDING bytes past the end of the report.
+enum { REPORT_PADDING = 8 };
+
+inline uint64_t load_le64(const unsigned char *d)
+{
+	uint64_t v;
+	memcpy(&v, d, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
 
 
 
+// Compact (16 byte) description of one report field. The usage name isn't
+// stored, but resolved by name() on demand.
 class hid_value {
 public:
-	hid_value(const hid_main_item *parent, uint32_t usage, const std::string &name,
-			unsigned int offset, unsigned int width) :
-		_parent(parent),
-		_usage(usage),
-		_name(name),
+	hid_value(uint32_t usage_page, uint32_t usage, bool named, unsigned int offset, unsigned int width) :
+		_usage_page(usage > 0xffff ? usage >> 16 : usage_page), // extended usage
+		_usage(usage & 0xffff),
 		_byte_offset(offset >> 3),
 		_bit_offset(offset & 7),
 		_width(width),
-		_mask((1 << width) - 1),
-		_msb(1 << (width - 1))
+		_mask(width >= 32 ? ~0u : (1u << width) - 1),
+		_named(named)
 	{}
 
+	// A field of up to 32 bits starts at bit 0..7 of its first byte and
+	// spans at most 5 bytes, so one 8 byte load always covers it.
 	uint32_t get_unsigned(const unsigned char *d) const
 	{
-		d += _byte_offset;
-		uint32_t ret = uint32_t(*d++);
-		if (_width > 8) {
-			ret |= uint32_t(*d++) << 8;
-			if (_width > 16) {
-				ret |= uint32_t(*d++) << 16;
-				if (_width > 24)
-					ret |= uint32_t(*d) << 24;
-			}
-		}
-		return (ret >> _bit_offset) & _mask;
+		return uint32_t(load_le64(d + _byte_offset) >> _bit_offset) & _mask;
 	}
 
 	int32_t get_signed(const unsigned char *d) const
 	{
-		uint32_t v = get_unsigned(d);
-		return _width && v & _msb ? v | ~_mask : v;
+		uint32_t sign = (_mask >> 1) + 1;
+		return int32_t((get_unsigned(d) ^ sign) - sign);
 	}
 
-	const hid_main_item *parent() const { return _parent; }
+	uint32_t usage_page() const { return _usage_page; }
 	int usage() const { return _usage; }
-	const std::string &name() const { return _name; }
+	unsigned int offset() const { return _byte_offset * 8 + _bit_offset; } // in bits
+	unsigned int width() const { return _width; }
+	std::string name() const;
 
 private:
-	const hid_main_item *_parent;
-	uint32_t _usage;
-	std::string _name;
-	unsigned int _byte_offset;
-	unsigned int _bit_offset;
-	unsigned int _width;
+	uint16_t _usage_page;
+	uint16_t _usage;
+	uint16_t _byte_offset;
+	uint8_t _bit_offset;
+	uint8_t _width;
 	uint32_t _mask;
-	uint32_t _msb;
+	bool _named; // usage from a Usage item (otherwise from Usage Minimum)
 };
 
 
 
+// Items are stored in one contiguous array in descriptor (pre-)order, with
+// the root at index 0. Instead of owning pointers they refer to each other
+// by index: an item's subtree are the items from its own index up to end(),
+// and its values are hid::values()[first_value() .. end_value()).
+// The global and local state are shared, immutable copies owned by the hid.
 class hid_main_item {
 public:
-	hid_main_item(main_type t, uint32_t dt, hid_main_item *parent, hid_global_data &g,
-			hid_local_data &l, int &bitpos);
-	~hid_main_item();
+	hid_main_item(main_type t, uint32_t dt, int parent, const hid_global_data *g,
+			const hid_local_data *l, unsigned int index, unsigned int first_value) :
+		_type(t),
+		_data_type(dt),
+		_parent(parent),
+		_end(index + 1),
+		_first_value(first_value),
+		_end_value(first_value),
+		_global(g),
+		_local(l)
+	{}
 
 	main_type type() const { return _type; }
 	uint32_t data_type() const { return _data_type; }
-	const hid_main_item *parent() const { return _parent; }
-	const hid_global_data &global() const { return _global; }
-	const hid_local_data &local() const { return _local; }
-	std::vector<hid_value> &values() { return _values; }
-	std::vector<hid_main_item *> &children() { return _children; }
+	int parent() const { return _parent; } // -1 for the root item
+	unsigned int end() const { return _end; }
+	unsigned int first_value() const { return _first_value; }
+	unsigned int end_value() const { return _end_value; }
+	const hid_global_data &global() const { return *_global; }
+	const hid_local_data &local() const { return *_local; }
 
 private:
+	friend class hid;
+
 	main_type _type;
 	uint32_t _data_type;
-	hid_main_item *_parent;
-	hid_global_data _global;
-	hid_local_data _local;
-	std::vector<hid_main_item *> _children;
-	std::vector<hid_value> _values;
+	int _parent;
+	unsigned int _end;
+	unsigned int _first_value;
+	unsigned int _end_value;
+	const hid_global_data *_global;
+	const hid_local_data *_local;
 };
 
 
@@ -186,13 +235,21 @@ private:
 class hid {
 public:
 	hid();
-	~hid();
 
 	void parse(const unsigned char *data, int len);
-	void print_input_report(hid_main_item *, const unsigned char *data);
-	const std::vector<hid_main_item *> &data() const { return _item_stack; }
+	void print_input_report(const unsigned char *data) const;
+	int write_decoder(std::ostream &os, const std::string &title,
+			const std::vector<std::vector<unsigned char> > &reports) const;
+	const std::vector<hid_main_item> &items() const { return _items; }
+	const std::vector<hid_value> &values() const { return _values; }
 
 private:
+	hid(const hid &);               // items point into the pools
+	hid &operator=(const hid &);
+
+	unsigned int add_item(main_type type, uint32_t data_type);
+	const hid_global_data *shared_global();
+	const hid_local_data *shared_local();
 	void do_main(int tag, uint32_t value);
 	void do_global(int tag, uint32_t value, int32_t svalue);
 	void do_local(int tag, uint32_t value);
@@ -200,8 +257,13 @@ private:
 	std::vector<hid_global_data> _data_stack;
 	hid_global_data _global;
 	hid_local_data _local;
-	hid_main_item *_item;
-	std::vector<hid_main_item *> _item_stack;
+	std::deque<hid_global_data> _global_pool; // distinct states, referenced by the items
+	std::deque<hid_local_data> _local_pool;
+	const hid_global_data *_shared_global;    // pooled copy of _global, 0 if that has changed
+	const hid_local_data *_shared_local;
+	std::vector<hid_main_item> _items;
+	std::vector<hid_value> _values;
+	std::vector<unsigned int> _item_stack; // open collections
 	std::string _indent;
 	int _bitpos;
 	int _depth;
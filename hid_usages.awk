@@ -0,0 +1,188 @@
+# generates hid_usages.cxx from hid_usages.txt (POSIX awk)
+#
+#   awk -f hid_usages.awk hid_usages.txt >hid_usages.cxx
+#
+# All names go into one string pool and are referred to by 16 bit offsets.
+# Each page gets a dense slice of the usages[] array, indexed by usage id,
+# and page_index[] maps page ids to the pages[] table. Offset 0 means
+# "no name". Everything is const POD, so it ends up in .rodata.
+
+function hex(s,    n, i) {
+	s = tolower(s)
+	sub(/^0x/, "", s)
+	n = 0
+	for (i = 1; i <= length(s); i++)
+		n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+	return n
+}
+
+function intern(s) {
+	if (!(s in offset)) {
+		offset[s] = poolsize
+		pool[npool++] = s
+		poolsize += length(s) + 1
+	}
+	return offset[s]
+}
+
+function cstring(s,    r, c, i) {
+	r = ""
+	for (i = 1; i <= length(s); i++) {
+		c = substr(s, i, 1)
+		if (c == "\\" || c == "\"")
+			r = r "\\"
+		r = r c
+	}
+	return r
+}
+
+function fail(msg) {
+	print FILENAME ":" FNR ": " msg >"/dev/stderr"
+	failed = 1
+	exit 1
+}
+
+BEGIN {
+	poolsize = 1
+	npool = 0
+	npages = 0
+}
+
+/^#/ || /^[ \t]*$/ {
+	next
+}
+
+$1 == "page" {
+	p = hex($2)
+	if (p > 255)
+		fail("page id out of range")
+	if (p in seen_page)
+		fail("duplicate page")
+	seen_page[p] = 1
+	name = $0
+	sub(/^page[ \t]+[^ \t]+[ \t]+/, "", name)
+	page_id[npages] = p
+	page_name[npages] = intern(name)
+	page_size[npages] = 0
+	npages++
+	next
+}
+
+{
+	if (!npages)
+		fail("usage outside of page")
+	u = hex($1)
+	cur = npages - 1
+	if ((cur, u) in usage)
+		fail("duplicate usage")
+	name = $0
+	sub(/^[^ \t]+[ \t]+/, "", name)
+	usage[cur, u] = intern(name)
+	if (u + 1 > page_size[cur])
+		page_size[cur] = u + 1
+}
+
+END {
+	if (failed)
+		exit 1
+	if (poolsize > 65535) {
+		print "string pool too large" >"/dev/stderr"
+		exit 1
+	}
+
+	print "// generated by hid_usages.awk from hid_usages.txt -- do not edit"
+	print "#include \"hid.hxx\""
+	print ""
+	print ""
+	print ""
+	print "namespace hid {"
+	print ""
+	print "namespace {"
+	print ""
+	print "struct usage_page {"
+	print "\tuint16_t name;"
+	print "\tuint16_t first;"
+	print "\tuint16_t size;"
+	print "};"
+	print ""
+	print ""
+	print ""
+	print "const char names[] ="
+	print "\t\"\\0\""
+	for (i = 0; i < npool; i++)
+		print "\t\"" cstring(pool[i]) "\\0\""
+	print ";"
+	print ""
+	print ""
+	print ""
+	print "const uint16_t usages[] = {"
+	first = 0
+	for (i = 0; i < npages; i++) {
+		page_first[i] = first
+		if (!page_size[i])
+			continue
+		printf "\t// 0x%02x\n", page_id[i]
+		for (u = 0; u < page_size[i]; u += 8) {
+			line = "\t"
+			for (k = u; k < u + 8 && k < page_size[i]; k++)
+				line = line ((i, k) in usage ? usage[i, k] : 0) ", "
+			sub(/ $/, "", line)
+			print line
+		}
+		first += page_size[i]
+	}
+	if (!first)
+		print "\t0"
+	print "};"
+	print ""
+	print ""
+	print ""
+	print "const usage_page pages[] = {"
+	for (i = 0; i < npages; i++)
+		printf "\t{ %d, %d, %d }, // 0x%02x\n", page_name[i], page_first[i], page_size[i], page_id[i]
+	print "};"
+	print ""
+	print ""
+	print ""
+	print "// pages[] index + 1, or 0 for unknown pages"
+	print "const uint8_t page_index[256] = {"
+	for (p = 0; p < 256; p += 16) {
+		line = "\t"
+		for (k = p; k < p + 16; k++) {
+			n = 0
+			for (i = 0; i < npages; i++)
+				if (page_id[i] == k)
+					n = i + 1
+			line = line n ", "
+		}
+		sub(/ $/, "", line)
+		print line
+	}
+	print "};"
+	print ""
+	print "} // namespace"
+	print ""
+	print ""
+	print ""
+	print "const char *usage_page_name(uint32_t page)"
+	print "{"
+	print "\tif (page > 0xff || !page_index[page])"
+	print "\t\treturn 0;"
+	print "\treturn names + pages[page_index[page] - 1].name;"
+	print "}"
+	print ""
+	print ""
+	print ""
+	print "const char *usage_name(uint32_t page, uint32_t id)"
+	print "{"
+	print "\tif (page > 0xff || !page_index[page])"
+	print "\t\treturn 0;"
+	print ""
+	print "\tconst usage_page &p = pages[page_index[page] - 1];"
+	print "\tif (id >= p.size || !usages[p.first + id])"
+	print "\t\treturn 0;"
+	print "\treturn names + usages[p.first + id];"
+	print "}"
+	print ""
+	print "} // namespace hid"
+}
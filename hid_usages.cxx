@@ -0,0 +1,1623 @@
+// generated by hid_usages.awk from hid_usages.txt -- do not edit
+#include "hid.hxx"
+
+
+
+namespace hid {
+
+namespace {
+
+struct usage_page {
+	uint16_t name;
+	uint16_t first;
+	uint16_t size;
+};
+
+
+
+const char names[] =
+	"\0"
+	"Undefined\0"
+	"Generic Desktop Controls\0"
+	"Pointer\0"
+	"Mouse\0"
+	"Joystick\0"
+	"Gamepad\0"
+	"Keyboard\0"
+	"Keypad\0"
+	"Multi-axis Controller\0"
+	"Tablet PC System Controls\0"
+	"X\0"
+	"Y\0"
+	"Z\0"
+	"Rx\0"
+	"Ry\0"
+	"Rz\0"
+	"Slider\0"
+	"Dial\0"
+	"Wheel\0"
+	"Hat switch\0"
+	"Counted Buffer\0"
+	"Byte Count\0"
+	"Motion Wakeup\0"
+	"Start\0"
+	"Select\0"
+	"Vx\0"
+	"Vy\0"
+	"Vz\0"
+	"Vbrx\0"
+	"Vbry\0"
+	"Vbrz\0"
+	"Vno\0"
+	"Feature Notification\0"
+	"Resolution Multiplier\0"
+	"System Control\0"
+	"System Power Down\0"
+	"System Sleep\0"
+	"System Wake Up\0"
+	"System Context Menu\0"
+	"System Main Menu\0"
+	"System App Menu\0"
+	"System Menu Help\0"
+	"System Menu Exit\0"
+	"System Menu Select\0"
+	"System Menu Right\0"
+	"System Menu Left\0"
+	"System Menu Up\0"
+	"System Menu Down\0"
+	"System Cold Restart\0"
+	"System Warm Restart\0"
+	"D-pad Up\0"
+	"D-pad Down\0"
+	"D-pad Right\0"
+	"D-pad Left\0"
+	"System Dock\0"
+	"System Undock\0"
+	"System Setup\0"
+	"System Break\0"
+	"System Debugger Break\0"
+	"Application Break\0"
+	"Application Debugger Break\0"
+	"System Speaker Mute\0"
+	"System Hibernate\0"
+	"System Display Invert\0"
+	"System Display Internal\0"
+	"System Display External\0"
+	"System Display Both\0"
+	"System Display Dual\0"
+	"System Display Toggle Int/Ext\0"
+	"System Display Swap Primary/Secondary\0"
+	"System Display LCD Autoscale\0"
+	"Simulation Controls\0"
+	"Flight Simulation Device\0"
+	"Automobile Simulation Device\0"
+	"Tank Simulation Device\0"
+	"Spaceship Simulation Device\0"
+	"Submarine Simulation Device\0"
+	"Sailing Simulation Device\0"
+	"Motorcycle Simulation Device\0"
+	"Sports Simulation Device\0"
+	"Airplane Simulation Device\0"
+	"Helicopter Simulation Device\0"
+	"Magic Carpet Simulation Device\0"
+	"Bicycle Simulation Device\0"
+	"Flight Control Stick\0"
+	"Flight Stick\0"
+	"Cyclic Control\0"
+	"Cyclic Trim\0"
+	"Flight Yoke\0"
+	"Track Control\0"
+	"Aileron\0"
+	"Aileron Trim\0"
+	"Anti-Torque Control\0"
+	"Autopilot Enable\0"
+	"Chaff Release\0"
+	"Collective Control\0"
+	"Dive Break\0"
+	"Electronic Countermeasures\0"
+	"Elevator\0"
+	"Elevator Trim\0"
+	"Rudder\0"
+	"Throttle\0"
+	"Flight Communications\0"
+	"Flare Release\0"
+	"Landing Gear\0"
+	"Toe Break\0"
+	"Trigger\0"
+	"Weapons Arm\0"
+	"Weapons Select\0"
+	"Wing Flaps\0"
+	"Accelerator\0"
+	"Brake\0"
+	"Clutch\0"
+	"Shifter\0"
+	"Steering\0"
+	"Turret Direction\0"
+	"Barrel Elevation\0"
+	"Dive Plane\0"
+	"Ballast\0"
+	"Bicycle Crank\0"
+	"Handle Bars\0"
+	"Front Brake\0"
+	"Rear Brake\0"
+	"VR Controls\0"
+	"Belt\0"
+	"Body Suit\0"
+	"Flexor\0"
+	"Glove\0"
+	"Head Tracker\0"
+	"Head Mounted Display\0"
+	"Hand Tracker\0"
+	"Oculometer\0"
+	"Vest\0"
+	"Animatronic Device\0"
+	"Stereo Enable\0"
+	"Display Enable\0"
+	"Sport Controls\0"
+	"Baseball Bat\0"
+	"Golf Club\0"
+	"Rowing Machine\0"
+	"Treadmill\0"
+	"Oar\0"
+	"Slope\0"
+	"Rate\0"
+	"Stick Speed\0"
+	"Stick Face Angle\0"
+	"Stick Heel/Toe\0"
+	"Stick Follow Through\0"
+	"Stick Tempo\0"
+	"Stick Type\0"
+	"Stick Height\0"
+	"Putter\0"
+	"1 Iron\0"
+	"2 Iron\0"
+	"3 Iron\0"
+	"4 Iron\0"
+	"5 Iron\0"
+	"6 Iron\0"
+	"7 Iron\0"
+	"8 Iron\0"
+	"9 Iron\0"
+	"10 Iron\0"
+	"11 Iron\0"
+	"Sand Wedge\0"
+	"Loft Wedge\0"
+	"Power Wedge\0"
+	"1 Wood\0"
+	"3 Wood\0"
+	"5 Wood\0"
+	"7 Wood\0"
+	"9 Wood\0"
+	"Game Controls\0"
+	"3D Game Controller\0"
+	"Pinball Device\0"
+	"Gun Device\0"
+	"Point of View\0"
+	"Turn Right/Left\0"
+	"Pitch Forward/Backward\0"
+	"Roll Right/Left\0"
+	"Move Right/Left\0"
+	"Move Forward/Backward\0"
+	"Move Up/Down\0"
+	"Lean Right/Left\0"
+	"Lean Forward/Backward\0"
+	"Height of POV\0"
+	"Flipper\0"
+	"Secondary Flipper\0"
+	"Bump\0"
+	"New Game\0"
+	"Shoot Ball\0"
+	"Player\0"
+	"Gun Bolt\0"
+	"Gun Clip\0"
+	"Gun Selectory\0"
+	"Gun Single Shot\0"
+	"Gun Burst\0"
+	"Gun Automatic\0"
+	"Gun Safety\0"
+	"Gamepad Fire/Jump\0"
+	"Gamepad Trigger\0"
+	"Generic Device Controls\0"
+	"Battery Strength\0"
+	"Wireless Channel\0"
+	"Wireless ID\0"
+	"Keyboard/Keypad\0"
+	"Keyboard ErrorRollOver\0"
+	"Keyboard POSTFail\0"
+	"Keyboard ErrorUndefined\0"
+	"Keyboard a and A\0"
+	"Keyboard b and B\0"
+	"Keyboard c and C\0"
+	"Keyboard d and D\0"
+	"Keyboard e and E\0"
+	"Keyboard f and F\0"
+	"Keyboard g and G\0"
+	"Keyboard h and H\0"
+	"Keyboard i and I\0"
+	"Keyboard j and J\0"
+	"Keyboard k and K\0"
+	"Keyboard l and L\0"
+	"Keyboard m and M\0"
+	"Keyboard n and N\0"
+	"Keyboard o and O\0"
+	"Keyboard p and P\0"
+	"Keyboard q and Q\0"
+	"Keyboard r and R\0"
+	"Keyboard s and S\0"
+	"Keyboard t and T\0"
+	"Keyboard u and U\0"
+	"Keyboard v and V\0"
+	"Keyboard w and W\0"
+	"Keyboard x and X\0"
+	"Keyboard y and Y\0"
+	"Keyboard z and Z\0"
+	"Keyboard 1 and !\0"
+	"Keyboard 2 and @\0"
+	"Keyboard 3 and #\0"
+	"Keyboard 4 and $\0"
+	"Keyboard 5 and %\0"
+	"Keyboard 6 and ^\0"
+	"Keyboard 7 and &\0"
+	"Keyboard 8 and *\0"
+	"Keyboard 9 and (\0"
+	"Keyboard 0 and )\0"
+	"Keyboard Return\0"
+	"Keyboard Escape\0"
+	"Keyboard Delete (Backspace)\0"
+	"Keyboard Tab\0"
+	"Keyboard Spacebar\0"
+	"Keyboard - and _\0"
+	"Keyboard = and +\0"
+	"Keyboard [ and {\0"
+	"Keyboard ] and }\0"
+	"Keyboard \\ and |\0"
+	"Keyboard Non-US # and ~\0"
+	"Keyboard ; and :\0"
+	"Keyboard ' and \"\0"
+	"Keyboard Grave Accent and Tilde\0"
+	"Keyboard , and <\0"
+	"Keyboard . and >\0"
+	"Keyboard / and ?\0"
+	"Keyboard Caps Lock\0"
+	"Keyboard F1\0"
+	"Keyboard F2\0"
+	"Keyboard F3\0"
+	"Keyboard F4\0"
+	"Keyboard F5\0"
+	"Keyboard F6\0"
+	"Keyboard F7\0"
+	"Keyboard F8\0"
+	"Keyboard F9\0"
+	"Keyboard F10\0"
+	"Keyboard F11\0"
+	"Keyboard F12\0"
+	"Keyboard PrintScreen\0"
+	"Keyboard Scroll Lock\0"
+	"Keyboard Pause\0"
+	"Keyboard Insert\0"
+	"Keyboard Home\0"
+	"Keyboard PageUp\0"
+	"Keyboard Delete Forward\0"
+	"Keyboard End\0"
+	"Keyboard PageDown\0"
+	"Keyboard RightArrow\0"
+	"Keyboard LeftArrow\0"
+	"Keyboard DownArrow\0"
+	"Keyboard UpArrow\0"
+	"Keypad Num Lock and Clear\0"
+	"Keypad /\0"
+	"Keypad *\0"
+	"Keypad -\0"
+	"Keypad +\0"
+	"Keypad ENTER\0"
+	"Keypad 1 and End\0"
+	"Keypad 2 and Down Arrow\0"
+	"Keypad 3 and PageDn\0"
+	"Keypad 4 and Left Arrow\0"
+	"Keypad 5\0"
+	"Keypad 6 and Right Arrow\0"
+	"Keypad 7 and Home\0"
+	"Keypad 8 and Up Arrow\0"
+	"Keypad 9 and PageUp\0"
+	"Keypad 0 and Insert\0"
+	"Keypad . and Delete\0"
+	"Keyboard Non-US \\ and |\0"
+	"Keyboard Application\0"
+	"Keyboard Power\0"
+	"Keypad =\0"
+	"Keyboard F13\0"
+	"Keyboard F14\0"
+	"Keyboard F15\0"
+	"Keyboard F16\0"
+	"Keyboard F17\0"
+	"Keyboard F18\0"
+	"Keyboard F19\0"
+	"Keyboard F20\0"
+	"Keyboard F21\0"
+	"Keyboard F22\0"
+	"Keyboard F23\0"
+	"Keyboard F24\0"
+	"Keyboard Execute\0"
+	"Keyboard Help\0"
+	"Keyboard Menu\0"
+	"Keyboard Select\0"
+	"Keyboard Stop\0"
+	"Keyboard Again\0"
+	"Keyboard Undo\0"
+	"Keyboard Cut\0"
+	"Keyboard Copy\0"
+	"Keyboard Paste\0"
+	"Keyboard Find\0"
+	"Keyboard Mute\0"
+	"Keyboard Volume Up\0"
+	"Keyboard Volume Down\0"
+	"Keyboard Locking Caps Lock\0"
+	"Keyboard Locking Num Lock\0"
+	"Keyboard Locking Scroll Lock\0"
+	"Keypad Comma\0"
+	"Keypad Equal Sign\0"
+	"Keyboard International1\0"
+	"Keyboard International2\0"
+	"Keyboard International3\0"
+	"Keyboard International4\0"
+	"Keyboard International5\0"
+	"Keyboard International6\0"
+	"Keyboard International7\0"
+	"Keyboard International8\0"
+	"Keyboard International9\0"
+	"Keyboard LANG1\0"
+	"Keyboard LANG2\0"
+	"Keyboard LANG3\0"
+	"Keyboard LANG4\0"
+	"Keyboard LANG5\0"
+	"Keyboard LANG6\0"
+	"Keyboard LANG7\0"
+	"Keyboard LANG8\0"
+	"Keyboard LANG9\0"
+	"Keyboard Alternate Erase\0"
+	"Keyboard SysReq/Attention\0"
+	"Keyboard Cancel\0"
+	"Keyboard Clear\0"
+	"Keyboard Prior\0"
+	"Keyboard Separator\0"
+	"Keyboard Out\0"
+	"Keyboard Oper\0"
+	"Keyboard Clear/Again\0"
+	"Keyboard CrSel/Props\0"
+	"Keyboard ExSel\0"
+	"Keypad 00\0"
+	"Keypad 000\0"
+	"Thousands Separator\0"
+	"Decimal Separator\0"
+	"Currency Unit\0"
+	"Currency Sub-unit\0"
+	"Keypad (\0"
+	"Keypad )\0"
+	"Keypad {\0"
+	"Keypad }\0"
+	"Keypad Tab\0"
+	"Keypad Backspace\0"
+	"Keypad A\0"
+	"Keypad B\0"
+	"Keypad C\0"
+	"Keypad D\0"
+	"Keypad E\0"
+	"Keypad F\0"
+	"Keypad XOR\0"
+	"Keypad ^\0"
+	"Keypad %\0"
+	"Keypad <\0"
+	"Keypad >\0"
+	"Keypad &\0"
+	"Keypad &&\0"
+	"Keypad |\0"
+	"Keypad ||\0"
+	"Keypad :\0"
+	"Keypad #\0"
+	"Keypad Space\0"
+	"Keypad @\0"
+	"Keypad !\0"
+	"Keypad Memory Store\0"
+	"Keypad Memory Recall\0"
+	"Keypad Memory Clear\0"
+	"Keypad Memory Add\0"
+	"Keypad Memory Subtract\0"
+	"Keypad Memory Multiply\0"
+	"Keypad Memory Divide\0"
+	"Keypad +/-\0"
+	"Keypad Clear\0"
+	"Keypad Clear Entry\0"
+	"Keypad Binary\0"
+	"Keypad Octal\0"
+	"Keypad Decimal\0"
+	"Keypad Hexadecimal\0"
+	"Keyboard LeftControl\0"
+	"Keyboard LeftShift\0"
+	"Keyboard LeftAlt\0"
+	"Keyboard Left GUI\0"
+	"Keyboard RightControl\0"
+	"Keyboard RightShift\0"
+	"Keyboard RightAlt\0"
+	"Keyboard Right GUI\0"
+	"LEDs\0"
+	"Num Lock\0"
+	"Caps Lock\0"
+	"Scroll Lock\0"
+	"Compose\0"
+	"Kana\0"
+	"Power\0"
+	"Shift\0"
+	"Do Not Disturb\0"
+	"Mute\0"
+	"Tone Enable\0"
+	"High Cut Filter\0"
+	"Low Cut Filter\0"
+	"Equalizer Enable\0"
+	"Sound Field On\0"
+	"Surround On\0"
+	"Repeat\0"
+	"Stereo\0"
+	"Sampling Rate Detect\0"
+	"Spinning\0"
+	"CAV\0"
+	"CLV\0"
+	"Recording Format Detect\0"
+	"Off-Hook\0"
+	"Ring\0"
+	"Message Waiting\0"
+	"Data Mode\0"
+	"Battery Operation\0"
+	"Battery OK\0"
+	"Battery Low\0"
+	"Speaker\0"
+	"Head Set\0"
+	"Hold\0"
+	"Microphone\0"
+	"Coverage\0"
+	"Night Mode\0"
+	"Send Calls\0"
+	"Call Pickup\0"
+	"Conference\0"
+	"Stand-by\0"
+	"Camera On\0"
+	"Camera Off\0"
+	"On-Line\0"
+	"Off-Line\0"
+	"Busy\0"
+	"Ready\0"
+	"Paper-Out\0"
+	"Paper-Jam\0"
+	"Remote\0"
+	"Forward\0"
+	"Reverse\0"
+	"Stop\0"
+	"Rewind\0"
+	"Fast Forward\0"
+	"Play\0"
+	"Pause\0"
+	"Record\0"
+	"Error\0"
+	"Usage Selected Indicator\0"
+	"Usage In Use Indicator\0"
+	"Usage Multi Mode Indicator\0"
+	"Indicator On\0"
+	"Indicator Flash\0"
+	"Indicator Slow Blink\0"
+	"Indicator Fast Blink\0"
+	"Indicator Off\0"
+	"Flash On Time\0"
+	"Slow Blink On Time\0"
+	"Slow Blink Off Time\0"
+	"Fast Blink On Time\0"
+	"Fast Blink Off Time\0"
+	"Usage Indicator Color\0"
+	"Indicator Red\0"
+	"Indicator Green\0"
+	"Indicator Amber\0"
+	"Generic Indicator\0"
+	"System Suspend\0"
+	"External Power Connected\0"
+	"Button\0"
+	"Ordinal\0"
+	"Telephony\0"
+	"Phone\0"
+	"Answering Machine\0"
+	"Message Controls\0"
+	"Handset\0"
+	"Headset\0"
+	"Telephony Key Pad\0"
+	"Programmable Button\0"
+	"Hook Switch\0"
+	"Flash\0"
+	"Feature\0"
+	"Redial\0"
+	"Transfer\0"
+	"Drop\0"
+	"Park\0"
+	"Forward Calls\0"
+	"Alternate Function\0"
+	"Line\0"
+	"Speaker Phone\0"
+	"Ring Enable\0"
+	"Ring Select\0"
+	"Phone Mute\0"
+	"Caller ID\0"
+	"Send\0"
+	"Speed Dial\0"
+	"Store Number\0"
+	"Recall Number\0"
+	"Phone Directory\0"
+	"Voice Mail\0"
+	"Screen Calls\0"
+	"Message\0"
+	"Answer On/Off\0"
+	"Inside Dial Tone\0"
+	"Outside Dial Tone\0"
+	"Inside Ring Tone\0"
+	"Outside Ring Tone\0"
+	"Priority Ring Tone\0"
+	"Inside Ringback\0"
+	"Priority Ringback\0"
+	"Line Busy Tone\0"
+	"Reorder Tone\0"
+	"Call Waiting Tone\0"
+	"Confirmation Tone 1\0"
+	"Confirmation Tone 2\0"
+	"Tones Off\0"
+	"Outside Ringback\0"
+	"Ringer\0"
+	"Phone Key 0\0"
+	"Phone Key 1\0"
+	"Phone Key 2\0"
+	"Phone Key 3\0"
+	"Phone Key 4\0"
+	"Phone Key 5\0"
+	"Phone Key 6\0"
+	"Phone Key 7\0"
+	"Phone Key 8\0"
+	"Phone Key 9\0"
+	"Phone Key Star\0"
+	"Phone Key Pound\0"
+	"Phone Key A\0"
+	"Phone Key B\0"
+	"Phone Key C\0"
+	"Phone Key D\0"
+	"Consumer\0"
+	"Consumer Control\0"
+	"Numeric Key Pad\0"
+	"Programmable Buttons\0"
+	"Headphone\0"
+	"Graphic Equalizer\0"
+	"+10\0"
+	"+100\0"
+	"AM/PM\0"
+	"Reset\0"
+	"Sleep\0"
+	"Sleep After\0"
+	"Sleep Mode\0"
+	"Illumination\0"
+	"Function Buttons\0"
+	"Menu\0"
+	"Menu Pick\0"
+	"Menu Up\0"
+	"Menu Down\0"
+	"Menu Left\0"
+	"Menu Right\0"
+	"Menu Escape\0"
+	"Menu Value Increase\0"
+	"Menu Value Decrease\0"
+	"Data On Screen\0"
+	"Closed Caption\0"
+	"Closed Caption Select\0"
+	"VCR/TV\0"
+	"Broadcast Mode\0"
+	"Snapshot\0"
+	"Still\0"
+	"Selection\0"
+	"Assign Selection\0"
+	"Mode Step\0"
+	"Recall Last\0"
+	"Enter Channel\0"
+	"Order Movie\0"
+	"Channel\0"
+	"Media Selection\0"
+	"Media Select Computer\0"
+	"Media Select TV\0"
+	"Media Select WWW\0"
+	"Media Select DVD\0"
+	"Media Select Telephone\0"
+	"Media Select Program Guide\0"
+	"Media Select Video Phone\0"
+	"Media Select Games\0"
+	"Media Select Messages\0"
+	"Media Select CD\0"
+	"Media Select VCR\0"
+	"Media Select Tuner\0"
+	"Quit\0"
+	"Help\0"
+	"Media Select Tape\0"
+	"Media Select Cable\0"
+	"Media Select Satellite\0"
+	"Media Select Security\0"
+	"Media Select Home\0"
+	"Media Select Call\0"
+	"Channel Increment\0"
+	"Channel Decrement\0"
+	"Media Select SAP\0"
+	"VCR Plus\0"
+	"Once\0"
+	"Daily\0"
+	"Weekly\0"
+	"Monthly\0"
+	"Scan Next Track\0"
+	"Scan Previous Track\0"
+	"Eject\0"
+	"Random Play\0"
+	"Select Disc\0"
+	"Enter Disc\0"
+	"Tracking\0"
+	"Track Normal\0"
+	"Slow Tracking\0"
+	"Frame Forward\0"
+	"Frame Back\0"
+	"Mark\0"
+	"Clear Mark\0"
+	"Repeat From Mark\0"
+	"Return To Mark\0"
+	"Search Mark Forward\0"
+	"Search Mark Backwards\0"
+	"Counter Reset\0"
+	"Show Counter\0"
+	"Tracking Increment\0"
+	"Tracking Decrement\0"
+	"Stop/Eject\0"
+	"Play/Pause\0"
+	"Play/Skip\0"
+	"Volume\0"
+	"Balance\0"
+	"Bass\0"
+	"Treble\0"
+	"Bass Boost\0"
+	"Surround Mode\0"
+	"Loudness\0"
+	"MPX\0"
+	"Volume Increment\0"
+	"Volume Decrement\0"
+	"Speed Select\0"
+	"Playback Speed\0"
+	"Standard Play\0"
+	"Long Play\0"
+	"Extended Play\0"
+	"Slow\0"
+	"Fan Enable\0"
+	"Fan Speed\0"
+	"Light Enable\0"
+	"Light Illumination Level\0"
+	"Climate Control Enable\0"
+	"Room Temperature\0"
+	"Security Enable\0"
+	"Fire Alarm\0"
+	"Police Alarm\0"
+	"Proximity\0"
+	"Motion\0"
+	"Duress Alarm\0"
+	"Holdup Alarm\0"
+	"Medical Alarm\0"
+	"Balance Right\0"
+	"Balance Left\0"
+	"Bass Increment\0"
+	"Bass Decrement\0"
+	"Treble Increment\0"
+	"Treble Decrement\0"
+	"Speaker System\0"
+	"Channel Left\0"
+	"Channel Right\0"
+	"Channel Center\0"
+	"Channel Front\0"
+	"Channel Center Front\0"
+	"Channel Side\0"
+	"Channel Surround\0"
+	"Channel Low Frequency Enhancement\0"
+	"Channel Top\0"
+	"Channel Unknown\0"
+	"Sub-channel\0"
+	"Sub-channel Increment\0"
+	"Sub-channel Decrement\0"
+	"Alternate Audio Increment\0"
+	"Alternate Audio Decrement\0"
+	"Application Launch Buttons\0"
+	"AL Launch Button Configuration Tool\0"
+	"AL Programmable Button Configuration\0"
+	"AL Consumer Control Configuration\0"
+	"AL Word Processor\0"
+	"AL Text Editor\0"
+	"AL Spreadsheet\0"
+	"AL Graphics Editor\0"
+	"AL Presentation App\0"
+	"AL Database App\0"
+	"AL Email Reader\0"
+	"AL Newsreader\0"
+	"AL Voicemail\0"
+	"AL Contacts/Address Book\0"
+	"AL Calendar/Schedule\0"
+	"AL Task/Project Manager\0"
+	"AL Log/Journal/Timecard\0"
+	"AL Checkbook/Finance\0"
+	"AL Calculator\0"
+	"AL A/V Capture/Playback\0"
+	"AL Local Machine Browser\0"
+	"AL LAN/WAN Browser\0"
+	"AL Internet Browser\0"
+	"AL Remote Networking/ISP Connect\0"
+	"AL Network Conference\0"
+	"AL Network Chat\0"
+	"AL Telephony/Dialer\0"
+	"AL Logon\0"
+	"AL Logoff\0"
+	"AL Logon/Logoff\0"
+	"AL Terminal Lock/Screensaver\0"
+	"AL Control Panel\0"
+	"AL Command Line Processor/Run\0"
+	"AL Process/Task Manager\0"
+	"AL Select Task/Application\0"
+	"AL Next Task/Application\0"
+	"AL Previous Task/Application\0"
+	"AL Preemptive Halt Task/Application\0"
+	"AL Integrated Help Center\0"
+	"AL Documents\0"
+	"AL Thesaurus\0"
+	"AL Dictionary\0"
+	"AL Desktop\0"
+	"AL Spell Check\0"
+	"AL Grammar Check\0"
+	"AL Wireless Status\0"
+	"AL Keyboard Layout\0"
+	"AL Virus Protection\0"
+	"AL Encryption\0"
+	"AL Screen Saver\0"
+	"AL Alarms\0"
+	"AL Clock\0"
+	"AL File Browser\0"
+	"AL Power Status\0"
+	"AL Image Browser\0"
+	"AL Audio Browser\0"
+	"AL Movie Browser\0"
+	"AL Digital Rights Manager\0"
+	"AL Digital Wallet\0"
+	"AL Instant Messaging\0"
+	"AL OEM Features/Tips/Tutorial Browser\0"
+	"AL OEM Help\0"
+	"AL Online Community\0"
+	"AL Entertainment Content Browser\0"
+	"AL Online Shopping Browser\0"
+	"AL SmartCard Information/Help\0"
+	"AL Market Monitor/Finance Browser\0"
+	"AL Customized Corporate News Browser\0"
+	"AL Online Activity Browser\0"
+	"AL Research/Search Browser\0"
+	"AL Audio Player\0"
+	"Generic GUI Application Controls\0"
+	"AC New\0"
+	"AC Open\0"
+	"AC Close\0"
+	"AC Exit\0"
+	"AC Maximize\0"
+	"AC Minimize\0"
+	"AC Save\0"
+	"AC Print\0"
+	"AC Properties\0"
+	"AC Undo\0"
+	"AC Copy\0"
+	"AC Cut\0"
+	"AC Paste\0"
+	"AC Select All\0"
+	"AC Find\0"
+	"AC Find and Replace\0"
+	"AC Search\0"
+	"AC Go To\0"
+	"AC Home\0"
+	"AC Back\0"
+	"AC Forward\0"
+	"AC Stop\0"
+	"AC Refresh\0"
+	"AC Previous Link\0"
+	"AC Next Link\0"
+	"AC Bookmarks\0"
+	"AC History\0"
+	"AC Subscriptions\0"
+	"AC Zoom In\0"
+	"AC Zoom Out\0"
+	"AC Zoom\0"
+	"AC Full Screen View\0"
+	"AC Normal View\0"
+	"AC View Toggle\0"
+	"AC Scroll Up\0"
+	"AC Scroll Down\0"
+	"AC Scroll\0"
+	"AC Pan Left\0"
+	"AC Pan Right\0"
+	"AC Pan\0"
+	"AC New Window\0"
+	"AC Tile Horizontally\0"
+	"AC Tile Vertically\0"
+	"AC Format\0"
+	"Digitizer\0"
+	"Pen\0"
+	"Light Pen\0"
+	"Touch Screen\0"
+	"Touch Pad\0"
+	"White Board\0"
+	"Coordinate Measuring Machine\0"
+	"3D Digitizer\0"
+	"Stereo Plotter\0"
+	"Articulated Arm\0"
+	"Armature\0"
+	"Multiple Point Digitizer\0"
+	"Free Space Wand\0"
+	"Stylus\0"
+	"Puck\0"
+	"Finger\0"
+	"Tip Pressure\0"
+	"Barrel Pressure\0"
+	"In Range\0"
+	"Touch\0"
+	"Untouch\0"
+	"Tap\0"
+	"Quality\0"
+	"Data Valid\0"
+	"Transducer Index\0"
+	"Tablet Function Keys\0"
+	"Program Change Keys\0"
+	"Invert\0"
+	"X Tilt\0"
+	"Y Tilt\0"
+	"Azimuth\0"
+	"Altitude\0"
+	"Twist\0"
+	"Tip Switch\0"
+	"Secondary Tip Switch\0"
+	"Barrel Switch\0"
+	"Eraser\0"
+	"Tablet Pick\0"
+	"Confidence\0"
+	"Width\0"
+	"Height\0"
+	"Contact Identifier\0"
+	"Device Mode\0"
+	"Device Identifier\0"
+	"Contact Count\0"
+	"Contact Count Maximum\0"
+	"PID Page\0"
+	"Physical Interface Device\0"
+	"Normal\0"
+	"Set Effect Report\0"
+	"Effect Block Index\0"
+	"Parameter Block Offset\0"
+	"ROM Flag\0"
+	"Effect Type\0"
+	"ET Constant Force\0"
+	"ET Ramp\0"
+	"ET Custom Force Data\0"
+	"ET Square\0"
+	"ET Sine\0"
+	"ET Triangle\0"
+	"ET Sawtooth Up\0"
+	"ET Sawtooth Down\0"
+	"ET Spring\0"
+	"ET Damper\0"
+	"ET Inertia\0"
+	"ET Friction\0"
+	"Duration\0"
+	"Sample Period\0"
+	"Gain\0"
+	"Trigger Button\0"
+	"Trigger Repeat Interval\0"
+	"Axes Enable\0"
+	"Direction Enable\0"
+	"Direction\0"
+	"Type Specific Block Offset\0"
+	"Block Type\0"
+	"Set Envelope Report\0"
+	"Attack Level\0"
+	"Attack Time\0"
+	"Fade Level\0"
+	"Fade Time\0"
+	"Set Condition Report\0"
+	"CP Offset\0"
+	"Positive Coefficient\0"
+	"Negative Coefficient\0"
+	"Positive Saturation\0"
+	"Negative Saturation\0"
+	"Dead Band\0"
+	"Download Force Sample\0"
+	"Isoch Custom Force Enable\0"
+	"Custom Force Data Report\0"
+	"Custom Force Data\0"
+	"Custom Force Vendor Defined Data\0"
+	"Set Custom Force Report\0"
+	"Custom Force Data Offset\0"
+	"Sample Count\0"
+	"Set Periodic Report\0"
+	"Offset\0"
+	"Magnitude\0"
+	"Phase\0"
+	"Period\0"
+	"Set Constant Force Report\0"
+	"Set Ramp Force Report\0"
+	"Ramp Start\0"
+	"Ramp End\0"
+	"Effect Operation Report\0"
+	"Effect Operation\0"
+	"Op Effect Start\0"
+	"Op Effect Start Solo\0"
+	"Op Effect Stop\0"
+	"Loop Count\0"
+	"Device Gain Report\0"
+	"Device Gain\0"
+	"PID Pool Report\0"
+	"RAM Pool Size\0"
+	"ROM Pool Size\0"
+	"ROM Effect Block Count\0"
+	"Simultaneous Effects Max\0"
+	"Pool Alignment\0"
+	"PID Pool Move Report\0"
+	"Move Source\0"
+	"Move Destination\0"
+	"Move Length\0"
+	"PID Block Load Report\0"
+	"Block Load Status\0"
+	"Block Load Success\0"
+	"Block Load Full\0"
+	"Block Load Error\0"
+	"Block Handle\0"
+	"PID Block Free Report\0"
+	"Type Specific Block Handle\0"
+	"PID State Report\0"
+	"Effect Playing\0"
+	"PID Device Control Report\0"
+	"PID Device Control\0"
+	"DC Enable Actuators\0"
+	"DC Disable Actuators\0"
+	"DC Stop All Effects\0"
+	"DC Device Reset\0"
+	"DC Device Pause\0"
+	"DC Device Continue\0"
+	"Device Paused\0"
+	"Actuators Enabled\0"
+	"Safety Switch\0"
+	"Actuator Override Switch\0"
+	"Actuator Power\0"
+	"Start Delay\0"
+	"Parameter Block Size\0"
+	"Device Managed Pool\0"
+	"Shared Parameter Blocks\0"
+	"Create New Effect Report\0"
+	"RAM Pool Available\0"
+	"Unicode\0"
+	"Alphanumeric Display\0"
+	"Bitmapped Display\0"
+	"Display Attributes Report\0"
+	"ASCII Character Set\0"
+	"Data Read Back\0"
+	"Font Read Back\0"
+	"Display Control Report\0"
+	"Clear Display\0"
+	"Screen Saver Delay\0"
+	"Screen Saver Enable\0"
+	"Vertical Scroll\0"
+	"Horizontal Scroll\0"
+	"Character Report\0"
+	"Display Data\0"
+	"Display Status\0"
+	"Stat Not Ready\0"
+	"Stat Ready\0"
+	"Err Not a loadable character\0"
+	"Err Font data cannot be read\0"
+	"Cursor Position Report\0"
+	"Row\0"
+	"Column\0"
+	"Rows\0"
+	"Columns\0"
+	"Cursor Pixel Positioning\0"
+	"Cursor Mode\0"
+	"Cursor Enable\0"
+	"Cursor Blink\0"
+	"Font Report\0"
+	"Font Data\0"
+	"Character Width\0"
+	"Character Height\0"
+	"Character Spacing Horizontal\0"
+	"Character Spacing Vertical\0"
+	"Unicode Character Set\0"
+	"Font 7-Segment\0"
+	"7-Segment Direct Map\0"
+	"Font 14-Segment\0"
+	"14-Segment Direct Map\0"
+	"Display Brightness\0"
+	"Display Contrast\0"
+	"Character Attribute\0"
+	"Attribute Readback\0"
+	"Attribute Data\0"
+	"Char Attr Enhance\0"
+	"Char Attr Underline\0"
+	"Char Attr Blink\0"
+	"Medical Instruments\0"
+	"Medical Ultrasound\0"
+	"VCR/Acquisition\0"
+	"Freeze/Thaw\0"
+	"Clip Store\0"
+	"Update\0"
+	"Next\0"
+	"Save\0"
+	"Print\0"
+	"Microphone Enable\0"
+	"Cine\0"
+	"Transmit Power\0"
+	"Focus\0"
+	"Depth\0"
+	"Soft Step - Primary\0"
+	"Soft Step - Secondary\0"
+	"Depth Gain Compensation\0"
+	"Zoom Select\0"
+	"Zoom Adjust\0"
+	"Spectral Doppler Mode Select\0"
+	"Spectral Doppler Adjust\0"
+	"Color Doppler Mode Select\0"
+	"Color Doppler Adjust\0"
+	"Motion Mode Select\0"
+	"Motion Mode Adjust\0"
+	"2-D Mode Select\0"
+	"2-D Mode Adjust\0"
+	"Soft Control Select\0"
+	"Soft Control Adjust\0"
+	"Monitor pages\0"
+	"Monitor Control\0"
+	"EDID Information\0"
+	"VDIF Information\0"
+	"VESA Version\0"
+	"Power pages\0"
+	"iName\0"
+	"PresentStatus\0"
+	"ChangedStatus\0"
+	"UPS\0"
+	"PowerSupply\0"
+	"BatterySystem\0"
+	"BatterySystemID\0"
+	"Battery\0"
+	"BatteryID\0"
+	"Charger\0"
+	"ChargerID\0"
+	"PowerConverter\0"
+	"PowerConverterID\0"
+	"OutletSystem\0"
+	"OutletSystemID\0"
+	"Input\0"
+	"InputID\0"
+	"Output\0"
+	"OutputID\0"
+	"Flow\0"
+	"FlowID\0"
+	"Outlet\0"
+	"OutletID\0"
+	"Gang\0"
+	"GangID\0"
+	"PowerSummary\0"
+	"PowerSummaryID\0"
+	"Voltage\0"
+	"Current\0"
+	"Frequency\0"
+	"ApparentPower\0"
+	"ActivePower\0"
+	"PercentLoad\0"
+	"Temperature\0"
+	"Humidity\0"
+	"BadCount\0"
+	"ConfigVoltage\0"
+	"ConfigCurrent\0"
+	"ConfigFrequency\0"
+	"ConfigApparentPower\0"
+	"ConfigActivePower\0"
+	"ConfigPercentLoad\0"
+	"ConfigTemperature\0"
+	"ConfigHumidity\0"
+	"SwitchOnControl\0"
+	"SwitchOffControl\0"
+	"ToggleControl\0"
+	"LowVoltageTransfer\0"
+	"HighVoltageTransfer\0"
+	"DelayBeforeReboot\0"
+	"DelayBeforeStartup\0"
+	"DelayBeforeShutdown\0"
+	"Test\0"
+	"ModuleReset\0"
+	"AudibleAlarmControl\0"
+	"Present\0"
+	"Good\0"
+	"InternalFailure\0"
+	"VoltageOutOfRange\0"
+	"FrequencyOutOfRange\0"
+	"Overload\0"
+	"OverCharged\0"
+	"OverTemperature\0"
+	"ShutdownRequested\0"
+	"ShutdownImminent\0"
+	"SwitchOn/Off\0"
+	"Switchable\0"
+	"Used\0"
+	"Boost\0"
+	"Buck\0"
+	"Initialized\0"
+	"Tested\0"
+	"AwaitingPower\0"
+	"CommunicationLost\0"
+	"Bar Code Scanner page\0"
+	"Scale page\0"
+	"Magnetic Stripe Reading (MSR) Devices\0"
+	"MSR Device Read-Only\0"
+	"Track 1 Length\0"
+	"Track 2 Length\0"
+	"Track 3 Length\0"
+	"Track JIS Length\0"
+	"Track Data\0"
+	"Track 1 Data\0"
+	"Track 2 Data\0"
+	"Track 3 Data\0"
+	"Track JIS Data\0"
+	"Reserved Point of Sale pages\0"
+	"Camera Control Page\0"
+	"Camera Auto-focus\0"
+	"Camera Shutter\0"
+	"Arcade Page\0"
+	"General Purpose IO Card\0"
+	"Coin Door\0"
+	"Watchdog Timer\0"
+	"General Purpose Analog Input State\0"
+	"General Purpose Digital Input State\0"
+	"General Purpose Optical Input State\0"
+	"General Purpose Digital Output State\0"
+	"Number of Coin Doors\0"
+	"Coin Drawer Drop Count\0"
+	"Coin Drawer Start\0"
+	"Coin Drawer Service\0"
+	"Coin Drawer Tilt\0"
+	"Coin Door Test\0"
+	"Coin Door Lockout\0"
+	"Watchdog Timeout\0"
+	"Watchdog Action\0"
+	"Watchdog Reboot\0"
+	"Watchdog Restart\0"
+	"Alarm Input\0"
+	"Coin Door Counter\0"
+	"I/O Direction Mapping\0"
+	"Set I/O Direction\0"
+	"Extended Optical Input State\0"
+	"Pin Pad Input State\0"
+	"Pin Pad Status\0"
+	"Pin Pad Output\0"
+	"Pin Pad Command\0"
+;
+
+
+
+const uint16_t usages[] = {
+	// 0x01
+	1, 36, 44, 0, 50, 59, 67, 76,
+	83, 105, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	131, 133, 135, 137, 140, 143, 146, 153,
+	158, 164, 175, 190, 201, 215, 221, 0,
+	228, 231, 234, 237, 242, 247, 252, 256,
+	277, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	299, 314, 332, 345, 360, 380, 397, 413,
+	430, 447, 466, 484, 501, 516, 533, 553,
+	573, 582, 593, 605, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	616, 628, 642, 655, 668, 690, 708, 735,
+	755, 0, 0, 0, 0, 0, 0, 0,
+	772, 794, 818, 842, 862, 882, 912, 950,
+	// 0x02
+	1, 999, 1024, 1053, 1076, 1104, 1132, 1158,
+	1187, 1212, 1239, 1268, 1299, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	1325, 1346, 1359, 1374, 1386, 1398, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	1412, 1420, 1433, 1453, 1470, 1484, 1503, 1514,
+	1541, 1550, 1564, 1571, 1580, 1602, 1616, 1629,
+	1639, 1647, 1659, 1674, 1685, 1697, 1703, 1710,
+	1718, 1727, 1744, 1761, 1772, 1780, 1794, 1806,
+	1818,
+	// 0x03
+	1, 1841, 1846, 1856, 1863, 1869, 1882, 1903,
+	1916, 1927, 1932, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	1951, 1965,
+	// 0x04
+	1, 1995, 2008, 2018, 2033, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	2043, 2047, 2053, 2058, 2070, 2087, 2102, 2123,
+	2135, 2146, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	2159, 2166, 2173, 2180, 2187, 2194, 2201, 2208,
+	2215, 2222, 2229, 2237, 2245, 2256, 2267, 2279,
+	2286, 2293, 2300, 2307,
+	// 0x05
+	1, 2328, 2347, 2362, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	2373, 2387, 2403, 2426, 2442, 2458, 2480, 2493,
+	2509, 2531, 2545, 2553, 2571, 2576, 2585, 2596,
+	2603, 2612, 2621, 2635, 2651, 2661, 2675, 2686,
+	0, 2704,
+	// 0x06
+	1, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	2744, 2761, 2778,
+	// 0x07
+	1, 2806, 2829, 2847, 2871, 2888, 2905, 2922,
+	2939, 2956, 2973, 2990, 3007, 3024, 3041, 3058,
+	3075, 3092, 3109, 3126, 3143, 3160, 3177, 3194,
+	3211, 3228, 3245, 3262, 3279, 3296, 3313, 3330,
+	3347, 3364, 3381, 3398, 3415, 3432, 3449, 3466,
+	3483, 3499, 3515, 3543, 3556, 3574, 3591, 3608,
+	3625, 3642, 3659, 3683, 3700, 3717, 3749, 3766,
+	3783, 3800, 3819, 3831, 3843, 3855, 3867, 3879,
+	3891, 3903, 3915, 3927, 3940, 3953, 3966, 3987,
+	4008, 4023, 4039, 4053, 4069, 4093, 4106, 4124,
+	4144, 4163, 4182, 4199, 4225, 4234, 4243, 4252,
+	4261, 4274, 4291, 4315, 4335, 4359, 4368, 4393,
+	4411, 4433, 4453, 4473, 4493, 4517, 4538, 4553,
+	4562, 4575, 4588, 4601, 4614, 4627, 4640, 4653,
+	4666, 4679, 4692, 4705, 4718, 4735, 4749, 4763,
+	4779, 4793, 4808, 4822, 4835, 4849, 4864, 4878,
+	4892, 4911, 4932, 4959, 4985, 5014, 5027, 5045,
+	5069, 5093, 5117, 5141, 5165, 5189, 5213, 5237,
+	5261, 5276, 5291, 5306, 5321, 5336, 5351, 5366,
+	5381, 5396, 5421, 5447, 5463, 5478, 3483, 5493,
+	5512, 5525, 5539, 5560, 5581, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	5596, 5606, 5617, 5637, 5655, 5669, 5687, 5696,
+	5705, 5714, 5723, 5734, 5751, 5760, 5769, 5778,
+	5787, 5796, 5805, 5816, 5825, 5834, 5843, 5852,
+	5861, 5871, 5880, 5890, 5899, 5908, 5921, 5930,
+	5939, 5959, 5980, 6000, 6018, 6041, 6064, 6085,
+	6096, 6109, 6128, 6142, 6155, 6170, 0, 0,
+	6189, 6210, 6229, 6246, 6264, 6286, 6306, 6324,
+	// 0x08
+	1, 6348, 6357, 6367, 6379, 6387, 6392, 6398,
+	6404, 6419, 6424, 6436, 6452, 6467, 6484, 6499,
+	6511, 6518, 6525, 6546, 6555, 6559, 6563, 6587,
+	6596, 6601, 6617, 6627, 6645, 6656, 6668, 6676,
+	6685, 6690, 6701, 6710, 6721, 6732, 6744, 6755,
+	6764, 6774, 6785, 6793, 6802, 6807, 6813, 6823,
+	6833, 6840, 6848, 6856, 6861, 6868, 6881, 6886,
+	6892, 6899, 6905, 6930, 6953, 6980, 6993, 7009,
+	7030, 7051, 7065, 7079, 7098, 7118, 7137, 7157,
+	7179, 7193, 7209, 7225, 7243, 7258,
+	// 0x0b
+	1, 7308, 7314, 7332, 7349, 7357, 7365, 7383,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	7403, 7415, 7421, 6685, 7429, 7436, 7445, 7450,
+	7455, 7469, 7488, 7493, 6744, 7507, 7519, 7531,
+	7542, 7552, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	7557, 7568, 7581, 7595, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	7611, 7622, 6404, 7635, 7643, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	7657, 7674, 7692, 7709, 7727, 7746, 7762, 7780,
+	7795, 7808, 7826, 7846, 7866, 7876, 7893, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	7900, 7912, 7924, 7936, 7948, 7960, 7972, 7984,
+	7996, 8008, 8020, 8035, 8051, 8063, 8075, 8087,
+	// 0x0c
+	1, 8108, 8125, 8141, 6690, 8162, 8172, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	8190, 8194, 8199, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	6392, 8205, 8211, 8217, 8229, 8240, 8253, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	8270, 8275, 8285, 8293, 8303, 8313, 8324, 8336,
+	8356, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	8376, 8391, 8406, 8428, 8435, 8450, 8459, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	8465, 8475, 8492, 8502, 8514, 8528, 8540, 8548,
+	8564, 8586, 8602, 8619, 8636, 8659, 8686, 8711,
+	8730, 8752, 8768, 8785, 8804, 8809, 8814, 8832,
+	8851, 8874, 8896, 8914, 8932, 8950, 8968, 0,
+	8985, 8994, 8999, 9005, 9012, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	6881, 6886, 6892, 6868, 6861, 9020, 9036, 6856,
+	9056, 9062, 9074, 9086, 6511, 9097, 9106, 9119,
+	9133, 9147, 9158, 9163, 9174, 9191, 9206, 9226,
+	9248, 9262, 9275, 9294, 9313, 9324, 9335, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	9345, 9352, 6419, 9360, 9365, 9372, 9383, 9397,
+	9406, 9410, 9427, 0, 0, 0, 0, 0,
+	9444, 9457, 9472, 9486, 9496, 9510, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	9515, 9526, 9536, 9549, 9574, 9597, 9614, 9630,
+	9641, 9654, 9664, 9671, 9684, 9697, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	9711, 9725, 9738, 9753, 9768, 9785, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	9802, 9817, 9830, 9844, 9859, 9873, 9894, 9907,
+	9924, 9958, 9970, 0, 0, 0, 0, 0,
+	9986, 9998, 10020, 10042, 10068, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	10094, 10121, 10157, 10194, 10228, 10246, 10261, 10276,
+	10295, 10315, 10331, 10347, 10361, 10374, 10399, 10420,
+	10444, 10468, 10489, 10503, 10527, 10552, 10571, 10591,
+	10624, 10646, 10662, 10682, 10691, 10701, 10717, 10746,
+	10763, 10793, 10817, 10844, 10869, 10898, 10934, 10960,
+	10973, 10986, 11000, 11011, 11026, 11043, 11062, 11081,
+	11101, 11115, 11131, 11141, 11150, 11166, 11182, 11199,
+	11216, 11233, 11259, 0, 11277, 11298, 11336, 11348,
+	11368, 11401, 11428, 11458, 11492, 11529, 11556, 11583,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	11599, 11632, 11639, 11647, 11656, 11664, 11676, 11688,
+	11696, 11705, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 11719, 11727, 11735, 11742, 11751, 11765,
+	11773, 11793, 11803, 11812, 11820, 11828, 11839, 11847,
+	11858, 11875, 11888, 11901, 11912, 11929, 11940, 11952,
+	11960, 11980, 11995, 12010, 12023, 12038, 12048, 12060,
+	12073, 12080, 12094, 12115, 12134,
+	// 0x0d
+	1, 12144, 12154, 12158, 12168, 12181, 12191, 12203,
+	12232, 12245, 12260, 12276, 12285, 12310, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	12326, 12333, 12338, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	12345, 12358, 12374, 12383, 12389, 12397, 12401, 12409,
+	12420, 12437, 12458, 2744, 12478, 12485, 12492, 12499,
+	12507, 12516, 12522, 12533, 12554, 12568, 12575, 12587,
+	12598, 12604, 0, 0, 0, 0, 0, 0,
+	0, 12611, 12630, 12642, 12660, 12674,
+	// 0x0f
+	1, 12705, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	12731, 12738, 12756, 12775, 12798, 12807, 12819, 12837,
+	12845, 0, 0, 0, 0, 0, 0, 0,
+	12866, 12876, 12884, 12896, 12911, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	12928, 12938, 12948, 12959, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	12971, 12980, 12994, 12999, 13014, 13038, 13050, 13067,
+	13077, 13104, 13115, 13135, 13148, 13160, 13171, 13181,
+	13202, 13212, 13233, 13254, 13274, 13294, 13304, 13326,
+	13352, 13377, 13395, 13428, 13452, 13477, 13490, 13510,
+	13517, 13527, 13533, 13540, 13566, 13588, 13599, 13608,
+	13632, 13649, 13665, 13686, 13701, 13712, 13731, 13743,
+	13759, 13773, 13787, 13810, 13835, 13850, 13871, 13883,
+	13900, 13912, 0, 13934, 13952, 13971, 13987, 14004,
+	14017, 14039, 14066, 0, 14083, 14098, 14124, 14143,
+	14163, 14184, 14204, 14220, 14236, 0, 0, 14255,
+	14269, 0, 0, 0, 14287, 14301, 14326, 14341,
+	14353, 14374, 14394, 14418, 14443,
+	// 0x14
+	1, 14470, 14491, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	14509, 14535, 14555, 14570, 14585, 14608, 1965, 14622,
+	14641, 14661, 14677, 14695, 14712, 14725, 14740, 14755,
+	14766, 14795, 14824, 14847, 14851, 14858, 14863, 14871,
+	14896, 14908, 14922, 14935, 14947, 14957, 14973, 14990,
+	15019, 15046, 15068, 15083, 15104, 15120, 15142, 15161,
+	15178, 15198, 15217, 15232, 15250, 15270,
+	// 0x40
+	1, 15306, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	15325, 15341, 15353, 15364, 15371, 15376, 15381, 15387,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	15405, 15410, 9345, 15425, 15431, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	15437, 15457, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	15479, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	15503, 15515, 15527, 15556, 15580, 15606, 15627, 15646,
+	15665, 15681, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	15697, 15717,
+	// 0x80
+	1, 15751, 15767, 15784, 15801,
+	// 0x84
+	1, 15826, 15832, 15846, 15860, 15864, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	15876, 15890, 15906, 15914, 15924, 15932, 15942, 15957,
+	15974, 15987, 16002, 16008, 16016, 16023, 16032, 16037,
+	16044, 16051, 16060, 16065, 16072, 16085, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	16100, 16108, 16116, 16126, 16140, 16152, 16164, 16176,
+	16185, 0, 0, 0, 0, 0, 0, 0,
+	16194, 16208, 16222, 16238, 16258, 16276, 16294, 16312,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	16327, 16343, 16360, 16374, 16393, 16413, 16431, 16450,
+	16470, 16475, 16487, 0, 0, 0, 0, 0,
+	16507, 16515, 16520, 16536, 16554, 16574, 16583, 16595,
+	16611, 16629, 0, 16646, 16659, 16670, 16675, 16681,
+	16686, 16698, 16705, 16719,
+	// 0x8e
+	1, 16808, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 16829, 16844, 16859, 16874, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	16891, 16902, 16915, 16928, 16941,
+	// 0x90
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	17005, 17023,
+	// 0x91
+	1, 17050, 17074, 17084, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	17099, 17134, 17170, 17206, 17243, 17264, 17287, 17305,
+	17325, 17342, 0, 0, 0, 0, 0, 17357,
+	17375, 17392, 17408, 17424, 17441, 17453, 17471, 17493,
+	17511, 17540, 17560, 17575, 17590,
+};
+
+
+
+const usage_page pages[] = {
+	{ 1, 0, 0 }, // 0x00
+	{ 11, 0, 184 }, // 0x01
+	{ 979, 184, 209 }, // 0x02
+	{ 1829, 393, 34 }, // 0x03
+	{ 1980, 427, 100 }, // 0x04
+	{ 2314, 527, 58 }, // 0x05
+	{ 2720, 585, 35 }, // 0x06
+	{ 2790, 620, 232 }, // 0x07
+	{ 6343, 852, 78 }, // 0x08
+	{ 7283, 930, 0 }, // 0x09
+	{ 7290, 930, 0 }, // 0x0a
+	{ 7298, 930, 192 }, // 0x0b
+	{ 8099, 1122, 573 }, // 0x0c
+	{ 12144, 1695, 86 }, // 0x0d
+	{ 12696, 1781, 173 }, // 0x0f
+	{ 14462, 1954, 0 }, // 0x10
+	{ 14470, 1954, 78 }, // 0x14
+	{ 15286, 2032, 162 }, // 0x40
+	{ 15737, 2194, 5 }, // 0x80
+	{ 15737, 2199, 0 }, // 0x81
+	{ 15737, 2199, 0 }, // 0x82
+	{ 15737, 2199, 0 }, // 0x83
+	{ 15814, 2199, 116 }, // 0x84
+	{ 15814, 2315, 0 }, // 0x85
+	{ 15814, 2315, 0 }, // 0x86
+	{ 15814, 2315, 0 }, // 0x87
+	{ 16737, 2315, 0 }, // 0x8c
+	{ 16759, 2315, 0 }, // 0x8d
+	{ 16770, 2315, 37 }, // 0x8e
+	{ 16956, 2352, 0 }, // 0x8f
+	{ 16985, 2352, 34 }, // 0x90
+	{ 17038, 2386, 77 }, // 0x91
+};
+
+
+
+// pages[] index + 1, or 0 for unknown pages
+const uint8_t page_index[256] = {
+	1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 0, 15,
+	16, 0, 0, 0, 17, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	18, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	19, 20, 21, 22, 23, 24, 25, 26, 0, 0, 0, 0, 27, 28, 29, 30,
+	31, 32, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+} // namespace
+
+
+
+const char *usage_page_name(uint32_t page)
+{
+	if (page > 0xff || !page_index[page])
+		return 0;
+	return names + pages[page_index[page] - 1].name;
+}
+
+
+
+const char *usage_name(uint32_t page, uint32_t id)
+{
+	if (page > 0xff || !page_index[page])
+		return 0;
+
+	const usage_page &p = pages[page_index[page] - 1];
+	if (id >= p.size || !usages[p.first + id])
+		return 0;
+	return names + usages[p.first + id];
+}
+
+} // namespace hid
@@ -0,0 +1,211 @@
+// js_serial_preload
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+// Test shim that makes regular files under $JS_SERIAL_PRELOAD_ROOT look like
+// joystick and event devices. The device is encoded in the file size:
+//
+//   n + 1         ... joystick n     (char device 15:n)
+//   1025 + n      ... event device n (char device 13:64+n)
+//
+// It has to be preloaded *after* js_serial_preload.so, so that the preload
+// library's RTLD_NEXT ioctl() is ours:
+//
+//   LD_PRELOAD=./js_serial_preload.so:./fake_input.so
+//
+// Needs glibc >= 2.33, where stat() and fstat() are real functions.
+//
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/ioctl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+// see js_serial_preload.c
+#define JSIOCGAXES      _IOC(_IOC_READ, 'j', 0x11, 1)
+#define JSIOCGBUTTONS   _IOC(_IOC_READ, 'j', 0x12, 1)
+#define JSIOCGNAME(len) _IOC(_IOC_READ, 'j', 0x13, len)
+#define EVIOCGNAME(len) _IOC(_IOC_READ, 'E', 0x06, len)
+#define EVIOCGUNIQ(len) _IOC(_IOC_READ, 'E', 0x08, len)
+
+#define FAKE_NAME "Fake Stick"
+#define FDMAX 4096
+
+enum { NONE, JOYSTICK, EVENT };
+
+int ioctl(int fd, unsigned long request, void *data);
+
+static struct {
+	int type;
+	int num;
+} fds[FDMAX];
+
+
+
+static void *next(const char *symbol)
+{
+	void *f = dlsym(RTLD_NEXT, symbol);
+	if (!f) {
+		fprintf(stderr, __FILE__": %s\n", dlerror());
+		exit(EXIT_FAILURE);
+	}
+	return f;
+}
+
+
+
+static int in_root(const char *path)
+{
+	const char *root = getenv("JS_SERIAL_PRELOAD_ROOT");
+	return root && *root && !strncmp(path, root, strlen(root));
+}
+
+
+
+// Turns the stat data of a fake device file into that of the device.
+static int fake_device(struct stat *st, int *num)
+{
+	if (!S_ISREG(st->st_mode) || st->st_size < 1 || st->st_size > 1280)
+		return NONE;
+
+	int type = st->st_size <= 256 ? JOYSTICK : EVENT;
+	*num = type == JOYSTICK ? st->st_size - 1 : st->st_size - 1025;
+	if (*num < 0)
+		return NONE;
+
+	st->st_mode = (st->st_mode & ~S_IFMT) | S_IFCHR;
+	st->st_rdev = type == JOYSTICK ? makedev(15, *num) : makedev(13, 64 + *num);
+	st->st_size = 0;
+	return type;
+}
+
+
+
+int stat(const char *path, struct stat *st)
+{
+	static int (*sys_stat)(const char *, struct stat *) = NULL;
+	if (!sys_stat)
+		sys_stat = next("stat");
+
+	int num, ret = sys_stat(path, st);
+	if (ret == 0 && in_root(path))
+		fake_device(st, &num);
+	return ret;
+}
+
+
+
+int fstat(int fd, struct stat *st)
+{
+	static int (*sys_fstat)(int, struct stat *) = NULL;
+	if (!sys_fstat)
+		sys_fstat = next("fstat");
+
+	int num, ret = sys_fstat(fd, st);
+	if (ret == 0 && fd >= 0 && fd < FDMAX && fds[fd].type)
+		fake_device(st, &num);
+	return ret;
+}
+
+
+
+int open(const char *path, int flags, ...)
+{
+	static int (*sys_open)(const char *, int, ...) = NULL;
+	if (!sys_open)
+		sys_open = next("open");
+
+	mode_t mode = 0;
+	if (flags & (O_CREAT | O_TMPFILE)) {
+		va_list ap;
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+
+	int fd = sys_open(path, flags, mode);
+	if (fd >= 0 && fd < FDMAX) {
+		fds[fd].type = NONE;
+		struct stat st;
+		if (in_root(path) && fstat(fd, &st) == 0)
+			fds[fd].type = fake_device(&st, &fds[fd].num);
+	}
+	return fd;
+}
+
+
+
+int close(int fd)
+{
+	static int (*sys_close)(int) = NULL;
+	if (!sys_close)
+		sys_close = next("close");
+
+	if (fd >= 0 && fd < FDMAX)
+		fds[fd].type = NONE;
+	return sys_close(fd);
+}
+
+
+
+static int copy_string(void *data, unsigned long request, const char *s)
+{
+	int len = strlen(s) + 1, size = _IOC_SIZE(request);
+	if (len > size)
+		len = size;
+	memcpy(data, s, len);
+	return len;
+}
+
+
+
+int ioctl(int fd, unsigned long request, void *data)
+{
+	static int (*sys_ioctl)(int, unsigned long, void *) = NULL;
+	if (!sys_ioctl)
+		sys_ioctl = next("ioctl");
+
+	if (fd < 0 || fd >= FDMAX || !fds[fd].type)
+		return sys_ioctl(fd, request, data);
+
+	char uniq[16];
+	unsigned long base = request & ~IOCSIZE_MASK;
+	if (fds[fd].type == JOYSTICK) {
+		if (base == JSIOCGNAME(0))
+			return copy_string(data, request, FAKE_NAME);
+		if (request == JSIOCGAXES)
+			return *(unsigned char *)data = 2, 0;
+		if (request == JSIOCGBUTTONS)
+			return *(unsigned char *)data = 8, 0;
+
+	} else if (base == EVIOCGNAME(0)) {
+		return copy_string(data, request, FAKE_NAME);
+
+	} else if (base == EVIOCGUNIQ(0)) {
+		snprintf(uniq, sizeof(uniq), "S%03d", fds[fd].num);
+		return copy_string(data, request, uniq);
+	}
+
+	errno = ENOTTY;
+	return -1;
+}
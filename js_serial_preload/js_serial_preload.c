@@ -18,13 +18,20 @@
 //
 #include <dirent.h>
 #include <dlfcn.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <linux/ioctl.h>
 #include <linux/major.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <unistd.h>
 
 // These macros can't be used from <linux/joystick.h> and <linux/input.h>, because
@@ -34,8 +41,9 @@
 #define EVIOCGNAME(len) _IOC(_IOC_READ, 'E', 0x06, len) // get device name
 #define EVIOCGUNIQ(len) _IOC(_IOC_READ, 'E', 0x08, len) // get unique identifier (serial number)
 
-#define JSDIR "/dev/input/by-id/"
-#define JSDIRLEN 17 // strlen(JSDIR)
+#define INPUTDIR "/dev/input/" // can be overridden with $JS_SERIAL_PRELOAD_ROOT (for tests)
+#define JSMAX 256   // joystick numbers are minor numbers, so they are < 256
+#define FDMAX 1024  // descriptors whose joystick number is cached
 
 #define STRINGIZE(X) DO_STRINGIZE(X)
 #define DO_STRINGIZE(X) #X
@@ -50,12 +58,38 @@
 
 int ioctl(int fd, unsigned long request, void *data);
 int (*sys_ioctl)(int fd, unsigned long request, void *data) = NULL;
-
-
-struct jsinfo {
-	int num;
+static int (*sys_close)(int fd) = NULL;
+static int (*sys_open)(const char *path, int flags, ...) = NULL;
+static int (*sys_open64)(const char *path, int flags, ...) = NULL;
+static int (*sys_openat)(int dirfd, const char *path, int flags, ...) = NULL;
+static int (*sys_openat64)(int dirfd, const char *path, int flags, ...) = NULL;
+static int (*sys_dup)(int oldfd) = NULL;
+static int (*sys_dup2)(int oldfd, int newfd) = NULL;
+static int (*sys_dup3)(int oldfd, int newfd, int flags) = NULL;
+
+
+// Joystick names and by-id links, indexed by joystick number. The table is
+// only filled on the first JSIOCGNAME request, so that processes that never
+// ask for a joystick name don't pay for the scan. After that it's kept up to
+// date with inotify events for jsdir, which are read on each JSIOCGNAME.
+static struct jsinfo {
 	char *name;
-} *joysticks = NULL;
+	char *link; // e.g. "usb-Leo_Bodnar_BU0836A_Interface_A12107-joystick"
+} joysticks[JSMAX];
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER; // protects joysticks and the watches
+static int inotify_fd = -1;
+static int jsdir_wd = -1;    // watch for jsdir
+static int inputdir_wd = -1; // watch for inputdir while jsdir doesn't exist
+static char inputdir[PATH_MAX] = INPUTDIR;
+static char jsdir[PATH_MAX] = INPUTDIR "by-id/";
+
+// Joystick number of each descriptor as found by fstat(): 0 = not known yet,
+// 1 = no joystick, num + 2 otherwise. Entries are reset when the descriptor
+// is closed or replaced by dup2()/dup3(), and when open*() or dup() hand out
+// its number again, as closes that bypass our close() (fclose(), close_range(),
+// syscall()) would otherwise leave stale entries.
+static unsigned short fd_cache[FDMAX];
 
 
 
@@ -63,7 +97,8 @@ static char *get_event_id(const char *path)
 {
 	int fd = open(path, O_RDONLY);
 	if (fd < 0) {
-		perror(ORIGIN"open");
+		if (errno != ENOENT) // the event link may not have been created yet
+			perror(ORIGIN"open");
 		return NULL;
 	}
 
@@ -109,113 +144,577 @@ static int get_js_number(const struct stat *s)
 
 
 
-static int is_js_file(const struct dirent *d)
+static int is_js_link(const char *name)
 {
-	size_t len = strlen(d->d_name);
-	if (len < 13 || strncmp(d->d_name, "usb-", 4) || strcmp(d->d_name + len - 9, "-joystick"))
+	size_t len = strlen(name);
+	if (len < 13 || strncmp(name, "usb-", 4) || strcmp(name + len - 9, "-joystick"))
 		return 0;
-	if (len > 15 && !strncmp(d->d_name + len - 15, "-event", 6))
+	if (len > 15 && !strncmp(name + len - 15, "-event", 6))
 		return 0;
 	return 1;
 }
 
 
 
-void __attribute__((constructor)) js_preload_begin(void)
+static int is_js_file(const struct dirent *d)
 {
-	dlerror();
-	sys_ioctl = dlsym(RTLD_NEXT, "ioctl");
-	char *error = dlerror();
-	if (error) {
-		fprintf(stderr, __FILE__": %s\n", error);
-		exit(EXIT_FAILURE);
+	return is_js_link(d->d_name);
+}
+
+
+
+// Turns the name of an "-event-joystick" link into that of its "-joystick"
+// link. Returns 0 if the name is neither.
+static int get_js_link(const char *name, char *link, size_t size)
+{
+	size_t len = strlen(name);
+	if (is_js_link(name)) {
+		snprintf(link, size, "%s", name);
+		return 1;
+	}
+	if (len > 19 && !strncmp(name, "usb-", 4) && !strcmp(name + len - 15, "-event-joystick")) {
+		snprintf(link, size, "%.*s-joystick", (int)(len - 15), name);
+		return 1;
 	}
+	return 0;
+}
 
-	struct dirent **files;
-	int num = scandir(JSDIR, &files, is_js_file, alphasort);
-	if (num < 0) {
-		perror(ORIGIN"scandir");
-		return;
+
+
+static void clear_joystick(struct jsinfo *js)
+{
+	free(js->name);
+	free(js->link);
+	js->name = js->link = NULL;
+}
+
+
+
+static void remove_joystick(const char *link)
+{
+	for (int i = 0; i < JSMAX; i++) {
+		if (joysticks[i].link && !strcmp(joysticks[i].link, link)) {
+			DBG(__FILE__": removed #%u '%s'\n", i, joysticks[i].name);
+			clear_joystick(&joysticks[i]);
+		}
 	}
+}
 
-	if ((joysticks = (struct jsinfo *)calloc(sizeof(struct jsinfo), num + 1)) == NULL) {
-		perror(ORIGIN"calloc");
-		goto out;
+
+
+// takes ownership of name
+static int set_joystick(int num, char *name, const char *link)
+{
+	char *link_copy = strdup(link);
+	if (name == NULL || link_copy == NULL) {
+		free(name);
+		free(link_copy);
+		return -1;
 	}
 
-	char path[PATH_MAX] = JSDIR;
-	for (int i = 0, n = 0; n < num; n++) {
-		strncpy(path + JSDIRLEN, files[n]->d_name, PATH_MAX - JSDIRLEN);
-		path[PATH_MAX - 1] = '\0';
+	remove_joystick(link); // a re-plugged board may have got another number
+	clear_joystick(&joysticks[num]);
+	joysticks[num].name = name;
+	joysticks[num].link = link_copy;
+	DBG(__FILE__": '%s'  <-  #%u '%s'(%d)\n", link, num, name, (int)strlen(name) + 1);
+	return 0;
+}
+
+
+
+// (Re-)reads the joystick behind jsdir/link. Fails quietly (returning -1) if
+// the device or its event link don't exist (yet); the next inotify event
+// retries. Links that don't lead to a joystick device are ignored.
+static int add_joystick(const char *link)
+{
+	char path[PATH_MAX];
+	if (snprintf(path, sizeof(path), "%s%s", jsdir, link) >= (int)sizeof(path))
+		return 0;
 
-		struct stat st;
-		if (stat(path, &st) < 0) {
+	struct stat st;
+	if (stat(path, &st) < 0) {
+		if (errno != ENOENT)
 			perror(ORIGIN"stat");
-			continue;
+		return -1;
+	}
+
+	int num = get_js_number(&st);
+	if (num < 0 || num >= JSMAX)
+		return 0;
+
+	size_t len = strlen(path) - 9;
+	strncpy(path + len, "-event-joystick", PATH_MAX - len);
+	path[PATH_MAX - 1] = '\0';
+
+	return set_joystick(num, get_event_id(path), link);
+}
+
+
+
+// The result of a complete scan is shared with other processes through a
+// cache file on a tmpfs. It's valid as long as jsdir's mtime matches, which
+// changes with every link that udev adds or removes. Writers replace it
+// atomically and increment its generation, so that a process that finds
+// the cache stale can see whether another one has refreshed it meanwhile.
+#define CACHE_MAGIC "jsprel1"
+
+struct cache_header {
+	char magic[8];
+	uint32_t generation;
+	uint32_t count;
+	int64_t mtime_sec;  // of jsdir
+	int64_t mtime_nsec;
+};
+
+struct cache_entry {
+	int32_t num;
+	char link[NAME_MAX + 1];
+	char name[256];
+};
+
+
+
+static int get_cache_path(char *path, size_t size)
+{
+	char root[16] = ""; // other device roots get their own cache
+	if (strcmp(inputdir, INPUTDIR)) {
+		uint32_t hash = 2166136261u; // FNV-1a
+		for (const char *c = inputdir; *c; c++)
+			hash = (hash ^ (unsigned char)*c) * 16777619u;
+		snprintf(root, sizeof(root), "-%08x", hash);
+	}
+
+	const char *dir = getenv("XDG_RUNTIME_DIR"); // private to the user
+	int n = dir && *dir ? snprintf(path, size, "%s/js_serial_preload%s.cache", dir, root)
+			: snprintf(path, size, "/dev/shm/js_serial_preload-%u%s.cache", (unsigned)getuid(), root);
+	return n > 0 && n < (int)size ? 0 : -1;
+}
+
+
+
+// Maps the cache read-only. Returns its header (to be released with
+// unmap_cache()) if it's intact and belongs to us, NULL otherwise.
+static const struct cache_header *map_cache(size_t *size)
+{
+	char path[PATH_MAX];
+	if (get_cache_path(path, sizeof(path)) < 0)
+		return NULL;
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	const struct cache_header *h = NULL;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_uid == getuid() && !(st.st_mode & 022)
+			&& (size_t)st.st_size >= sizeof(struct cache_header)) {
+		void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (p != MAP_FAILED) {
+			h = (const struct cache_header *)p;
+			*size = st.st_size;
+			if (memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) || h->count > JSMAX
+					|| *size < sizeof(*h) + h->count * sizeof(struct cache_entry)) {
+				munmap(p, *size);
+				h = NULL;
+			}
 		}
+	}
+	close(fd);
+	return h;
+}
 
-		if ((joysticks[i].num = get_js_number(&st)) < 0)
-			continue;
 
-		size_t len = strlen(path) - 9;
-		strncpy(path + len, "-event-joystick", PATH_MAX - len);
-		path[PATH_MAX - 1] = '\0';
 
-		if ((joysticks[i].name = get_event_id(path)) == NULL)
+static int cache_is_current(const struct cache_header *h, const struct stat *dir)
+{
+	return h->mtime_sec == dir->st_mtim.tv_sec && h->mtime_nsec == dir->st_mtim.tv_nsec;
+}
+
+
+
+// Fills the table from the cache if that is current. Returns the cache's
+// generation in any case (0 if there's none).
+static int load_cache(const struct stat *dir, uint32_t *generation)
+{
+	size_t size;
+	const struct cache_header *h = map_cache(&size);
+	*generation = h ? h->generation : 0;
+	if (!h)
+		return -1;
+
+	int ret = -1;
+	if (cache_is_current(h, dir)) {
+		const struct cache_entry *e = (const struct cache_entry *)(h + 1);
+		for (uint32_t i = 0; i < h->count; i++, e++) {
+			if (e->num < 0 || e->num >= JSMAX || !memchr(e->link, 0, sizeof(e->link))
+					|| !memchr(e->name, 0, sizeof(e->name)))
+				continue;
+			set_joystick(e->num, strdup(e->name), e->link);
+		}
+		DBG(__FILE__": %u joysticks from cache generation %u\n", h->count, h->generation);
+		ret = 0;
+	}
+	munmap((void *)h, size);
+	return ret;
+}
+
+
+
+static void save_cache(const struct stat *dir, uint32_t generation)
+{
+	char path[PATH_MAX], tmp[PATH_MAX + 32];
+	if (get_cache_path(path, sizeof(path)) < 0)
+		return;
+
+	// somebody else may have refreshed it while we were scanning
+	size_t size;
+	const struct cache_header *h = map_cache(&size);
+	if (h) {
+		int done = h->generation != generation && cache_is_current(h, dir);
+		munmap((void *)h, size);
+		if (done)
+			return;
+	}
+
+	size = sizeof(struct cache_header) + JSMAX * sizeof(struct cache_entry);
+	struct cache_header *c = (struct cache_header *)calloc(1, size);
+	if (c == NULL)
+		return;
+
+	memcpy(c->magic, CACHE_MAGIC, sizeof(c->magic));
+	c->generation = generation + 1;
+	c->mtime_sec = dir->st_mtim.tv_sec;
+	c->mtime_nsec = dir->st_mtim.tv_nsec;
+	struct cache_entry *e = (struct cache_entry *)(c + 1);
+	for (int i = 0; i < JSMAX; i++) {
+		if (!joysticks[i].name)
 			continue;
+		e->num = i;
+		snprintf(e->link, sizeof(e->link), "%s", joysticks[i].link);
+		snprintf(e->name, sizeof(e->name), "%s", joysticks[i].name);
+		e++;
+		c->count++;
+	}
+	size = (char *)e - (char *)c;
+
+	snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd >= 0) {
+		int ok = write(fd, c, size) == (ssize_t)size;
+		if (close(fd) < 0 || !ok || rename(tmp, path) < 0)
+			unlink(tmp);
+		else
+			DBG(__FILE__": wrote cache generation %u\n", c->generation);
+	}
+	free(c);
+}
 
-		DBG(__FILE__": '%s'  <-  #%u '%s'(%d)\n", path, joysticks[i].num,
-				joysticks[i].name, (int)strlen(joysticks[i].name) + 1);
-		i++;
+
+
+static void scan_joysticks(void)
+{
+	struct stat dir;
+	uint32_t generation = 0;
+	int have_dir = stat(jsdir, &dir) == 0;
+	if (have_dir && load_cache(&dir, &generation) == 0)
+		return;
+
+	struct dirent **files;
+	int num = scandir(jsdir, &files, is_js_file, alphasort);
+	if (num < 0) {
+		if (errno != ENOENT) // there's no by-id directory without input devices
+			perror(ORIGIN"scandir");
+		return;
 	}
 
-out:
-	while (num--)
-		free(files[num]);
+	int complete = 1;
+	for (int n = 0; n < num; n++) {
+		if (add_joystick(files[n]->d_name) < 0)
+			complete = 0;
+		free(files[n]);
+	}
 	free(files);
+
+	// only share complete results, and only if jsdir hasn't changed meanwhile
+	struct stat after;
+	if (complete && have_dir && stat(jsdir, &after) == 0 && after.st_mtim.tv_sec == dir.st_mtim.tv_sec
+			&& after.st_mtim.tv_nsec == dir.st_mtim.tv_nsec)
+		save_cache(&dir, generation);
 }
 
 
 
-void __attribute__((destructor)) js_preload_end(void)
+// Watches jsdir, or inputdir until jsdir is created. Called with the lock held.
+static void watch_jsdir(void)
 {
-	if (joysticks) {
-		for (struct jsinfo *js = joysticks; js->name; js++)
-			free(js->name);
-		free(joysticks);
+	jsdir_wd = inotify_add_watch(inotify_fd, jsdir, IN_CREATE | IN_DELETE | IN_MOVED_FROM
+			| IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR);
+	if (jsdir_wd >= 0) {
+		if (inputdir_wd >= 0) {
+			inotify_rm_watch(inotify_fd, inputdir_wd);
+			inputdir_wd = -1;
+		}
+		scan_joysticks();
+		return;
 	}
+
+	if (inputdir_wd < 0)
+		inputdir_wd = inotify_add_watch(inotify_fd, inputdir, IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+	if (inputdir_wd < 0 && errno != ENOENT)
+		perror(ORIGIN"inotify_add_watch");
 }
 
 
 
-int ioctl(int fd, unsigned long request, void *data)
+static void init_joysticks(void)
 {
-	int ret = sys_ioctl(fd, request, data);
-	if ((request & ~IOCSIZE_MASK) != JSIOCGNAME(0) || !joysticks)
-		return ret;
+	const char *root = getenv("JS_SERIAL_PRELOAD_ROOT");
+	if (root && *root) {
+		size_t len = strlen(root);
+		if (snprintf(inputdir, sizeof(inputdir), "%s%s", root, root[len - 1] == '/' ? "" : "/")
+				>= (int)sizeof(inputdir)
+				|| snprintf(jsdir, sizeof(jsdir), "%sby-id/", inputdir) >= (int)sizeof(jsdir)) {
+			fprintf(stderr, ORIGIN"JS_SERIAL_PRELOAD_ROOT too long\n");
+			strcpy(inputdir, INPUTDIR);
+			strcpy(jsdir, INPUTDIR "by-id/");
+		}
+	}
+
+	pthread_mutex_lock(&lock);
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0) {
+		perror(ORIGIN"inotify_init1");
+		scan_joysticks();
+	} else {
+		watch_jsdir();
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+
+
+// Applies pending inotify events to the joystick table. Only the entries of
+// the links that changed are touched. Called with the lock held.
+static void update_joysticks(void)
+{
+	if (inotify_fd < 0)
+		return;
+
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+	while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+		for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+			const struct inotify_event *ev = (const struct inotify_event *)p;
+			char link[NAME_MAX + 1];
+
+			if (ev->mask & IN_Q_OVERFLOW) { // events were lost
+				for (int i = 0; i < JSMAX; i++)
+					clear_joystick(&joysticks[i]);
+				scan_joysticks();
+
+			} else if (ev->wd == jsdir_wd && (ev->mask & (IN_DELETE_SELF | IN_IGNORED))) {
+				for (int i = 0; i < JSMAX; i++)
+					clear_joystick(&joysticks[i]);
+				jsdir_wd = -1;
+				watch_jsdir();
+
+			} else if (ev->wd == inputdir_wd && ev->len && !strcmp(ev->name, "by-id")) {
+				watch_jsdir();
+
+			} else if (ev->wd == jsdir_wd && ev->len && get_js_link(ev->name, link, sizeof(link))) {
+				if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+					remove_joystick(link);
+				else
+					add_joystick(link);
+			}
+		}
+	}
+	if (len < 0 && errno != EAGAIN && errno != EINTR)
+		perror(ORIGIN"read/inotify");
+}
+
+void __attribute__((constructor)) js_preload_begin(void)
+{
+	dlerror();
+	sys_ioctl = dlsym(RTLD_NEXT, "ioctl");
+	sys_close = dlsym(RTLD_NEXT, "close");
+	sys_dup2 = dlsym(RTLD_NEXT, "dup2");
+	sys_dup3 = dlsym(RTLD_NEXT, "dup3");
+	char *error = dlerror();
+	if (error) {
+		fprintf(stderr, __FILE__": %s\n", error);
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+
+void __attribute__((destructor)) js_preload_end(void)
+{
+	for (int i = 0; i < JSMAX; i++)
+		clear_joystick(&joysticks[i]);
+	if (inotify_fd >= 0)
+		sys_close(inotify_fd);
+}
+
+
+
+static void forget_fd(int fd)
+{
+	if (fd >= 0 && fd < FDMAX)
+		__atomic_store_n(&fd_cache[fd], 0, __ATOMIC_RELAXED);
+}
+
+
+
+// joystick number of fd, or -1
+static int get_fd_js_number(int fd)
+{
+	int cached = fd >= 0 && fd < FDMAX ? __atomic_load_n(&fd_cache[fd], __ATOMIC_RELAXED) : 0;
+	if (cached)
+		return cached - 2;
 
 	struct stat st;
 	if (fstat(fd, &st) < 0) {
 		perror(ORIGIN"fstat");
-		return ret;
+		return -1;
 	}
 
+	int num = get_js_number(&st);
+	if (num >= JSMAX)
+		num = -1;
+	if (fd >= 0 && fd < FDMAX)
+		__atomic_store_n(&fd_cache[fd], num + 2, __ATOMIC_RELAXED);
+	return num;
+}
+
+
+
+int ioctl(int fd, unsigned long request, void *data)
+{
+	int ret = sys_ioctl(fd, request, data);
+	if (ret < 0 || (request & ~IOCSIZE_MASK) != JSIOCGNAME(0))
+		return ret;
+
+	pthread_once(&init_once, init_joysticks);
+
 	int num, size = _IOC_SIZE(request);
-	if ((num = get_js_number(&st)) < 0)
+	if ((num = get_fd_js_number(fd)) < 0)
 		return ret;
 
+	pthread_mutex_lock(&lock);
+	update_joysticks();
+	const char *name = joysticks[num].name;
 	DBG(__FILE__": JSIOCGNAME(%d) = #%u '%s'(%d)", size, num, (char *)data, ret);
-	for (struct jsinfo *js = joysticks; js->name; js++) {
-		if (js->num == num) {
-			int len = (int)strlen(js->name);
-			if (len < size) {
-				strcpy(data, js->name);
-				ret = ++len;
-				DBG("  ->  '%s'(%d)", (char *)data, ret);
-			}
-			break;
-		}
+	if (name && (int)strlen(name) < size) {
+		strcpy(data, name);
+		ret = (int)strlen(name) + 1;
+		DBG("  ->  '%s'(%d)", (char *)data, ret);
 	}
 	DBG("\n");
+	pthread_mutex_unlock(&lock);
+	return ret;
+}
+
+
+
+int close(int fd)
+{
+	if (!sys_close)
+		sys_close = dlsym(RTLD_NEXT, "close"); // called before our constructor
+	forget_fd(fd);
+	return sys_close(fd);
+}
+
+
+
+// mode argument of open()/openat(), if there is one
+#define OPEN_MODE(flags, last) ({ \
+	mode_t mode = 0; \
+	if ((flags) & (O_CREAT | O_TMPFILE)) { \
+		va_list ap; \
+		va_start(ap, last); \
+		mode = va_arg(ap, mode_t); \
+		va_end(ap); \
+	} \
+	mode; \
+})
+
+
+
+int open(const char *path, int flags, ...)
+{
+	if (!sys_open)
+		sys_open = dlsym(RTLD_NEXT, "open");
+	int fd = sys_open(path, flags, OPEN_MODE(flags, flags));
+	forget_fd(fd);
+	return fd;
+}
+
+
+
+int open64(const char *path, int flags, ...)
+{
+	if (!sys_open64)
+		sys_open64 = dlsym(RTLD_NEXT, "open64");
+	int fd = sys_open64(path, flags, OPEN_MODE(flags, flags));
+	forget_fd(fd);
+	return fd;
+}
+
+
+
+int openat(int dirfd, const char *path, int flags, ...)
+{
+	if (!sys_openat)
+		sys_openat = dlsym(RTLD_NEXT, "openat");
+	int fd = sys_openat(dirfd, path, flags, OPEN_MODE(flags, flags));
+	forget_fd(fd);
+	return fd;
+}
+
+
+
+int openat64(int dirfd, const char *path, int flags, ...)
+{
+	if (!sys_openat64)
+		sys_openat64 = dlsym(RTLD_NEXT, "openat64");
+	int fd = sys_openat64(dirfd, path, flags, OPEN_MODE(flags, flags));
+	forget_fd(fd);
+	return fd;
+}
+
+
+
+int dup(int oldfd)
+{
+	if (!sys_dup)
+		sys_dup = dlsym(RTLD_NEXT, "dup");
+	int fd = sys_dup(oldfd);
+	forget_fd(fd);
+	return fd;
+}
+
+
+
+int dup2(int oldfd, int newfd)
+{
+	if (!sys_dup2)
+		sys_dup2 = dlsym(RTLD_NEXT, "dup2");
+	int ret = sys_dup2(oldfd, newfd);
+	if (ret >= 0)
+		forget_fd(newfd);
+	return ret;
+}
+
+
+
+int dup3(int oldfd, int newfd, int flags)
+{
+	if (!sys_dup3)
+		sys_dup3 = dlsym(RTLD_NEXT, "dup3");
+	int ret = sys_dup3(oldfd, newfd, flags);
+	if (ret >= 0)
+		forget_fd(newfd);
 	return ret;
 }
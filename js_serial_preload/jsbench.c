@@ -0,0 +1,427 @@
+// js_serial_preload
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+// Tests and benchmarks js_serial_preload.so on a fake device tree (see
+// fake_input.c) with 1, 16 and 256 joysticks, or the given numbers. For each
+// it checks the names (also after hotplug, dup2(), and a close() that
+// bypasses the library), and measures:
+//
+//   exec   ... fork + exec + exit of a process that doesn't use joysticks,
+//              so the difference is the cost of loading the library
+//   first  ... first JSIOCGNAME of a process, which scans the tree (cold)
+//              or loads the shared cache
+//   call   ... every later JSIOCGNAME
+//   read   ... a read() of an empty inotify descriptor, the one system call
+//              that a cached JSIOCGNAME makes
+//
+// "shim" runs with fake_input.so only, "preload" with both libraries. The run
+// fails if the preload library exceeds its budgets: loading it may cost at
+// most EXEC_BUDGET times the exec without it, a JSIOCGNAME at most the shim's
+// plus CALL_BUDGET reads, the cached first call at most the cold one, and the
+// per-call cost may grow at most SCALE_BUDGET times from the fewest to the
+// most joysticks (the names are indexed, not searched).
+//
+#include <fcntl.h>
+#include <ftw.h>
+#include <glob.h>
+#include <libgen.h>
+#include <limits.h>
+#include <linux/joystick.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define EXEC_RUNS 100
+#define FIRST_RUNS 20
+#define CALLS 200000
+
+#define EXEC_BUDGET 3.0
+#define CALL_BUDGET 1.5
+#define SCALE_BUDGET 2.0
+
+static char self[PATH_MAX];
+static char shim[PATH_MAX + 32];
+static char preload[2 * PATH_MAX + 64];
+static char root[PATH_MAX - 64]; // leaves room for the names in it
+
+
+
+static double now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+
+
+static int fail(const char *msg)
+{
+	perror(msg);
+	return -1;
+}
+
+
+
+// --- child side: runs with LD_PRELOAD set ----------------------------------
+
+static int open_js(int num)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/js%d", root, num);
+	return open(path, O_RDONLY);
+}
+
+
+
+static int expect_name(int fd, const char *expected, const char *what)
+{
+	char name[128];
+	if (ioctl(fd, JSIOCGNAME(sizeof(name)), name) < 0)
+		return fail("ioctl/JSIOCGNAME");
+	if (!strcmp(name, expected))
+		return 0;
+	fprintf(stderr, "%s: got '%s', expected '%s'\n", what, name, expected);
+	return -1;
+}
+
+
+
+static int link_js(int num, int add)
+{
+	static const char *suffix[2] = { "joystick", "event-joystick" };
+	for (int i = 0; i < 2; i++) {
+		char link[PATH_MAX], target[32];
+		snprintf(link, sizeof(link), "%s/by-id/usb-Fake_Stick_S%03d-%s", root, num, suffix[i]);
+		snprintf(target, sizeof(target), "../%s%d", i ? "event" : "js", num);
+		if (add ? symlink(target, link) : unlink(link))
+			return fail(link);
+	}
+	return 0;
+}
+
+
+
+static int check(int count)
+{
+	char expected[64];
+	int errors = 0, fd;
+
+	for (int n = 0; n < count; n++) {
+		if ((fd = open_js(n)) < 0)
+			return fail("open");
+		snprintf(expected, sizeof(expected), "Fake Stick S%03d", n);
+		errors += expect_name(fd, expected, "scan") < 0;
+		close(fd);
+	}
+
+	// the descriptor of js0 becomes that of the last joystick
+	int fd0 = open_js(0), fd1 = open_js(count - 1);
+	if (fd0 < 0 || fd1 < 0)
+		return fail("open");
+	errors += expect_name(fd0, "Fake Stick S000", "dup2 (before)") < 0;
+	if (dup2(fd1, fd0) < 0)
+		return fail("dup2");
+	snprintf(expected, sizeof(expected), "Fake Stick S%03d", count - 1);
+	errors += expect_name(fd0, expected, "dup2") < 0;
+	close(fd0);
+	close(fd1);
+
+	// a close that the library doesn't see (like fclose() or close_range()),
+	// then the same descriptor number for another joystick
+	if ((fd0 = open_js(0)) < 0)
+		return fail("open");
+	errors += expect_name(fd0, "Fake Stick S000", "reuse (before)") < 0;
+	syscall(SYS_close, fd0);
+	if ((fd1 = open_js(count - 1)) < 0)
+		return fail("open");
+	if (fd1 != fd0)
+		fprintf(stderr, "reuse: got descriptor %d instead of %d\n", fd1, fd0);
+	errors += expect_name(fd1, expected, "reuse") < 0;
+	close(fd1);
+
+	// unplug and replug js0; the "-joystick" link comes first, so that the
+	// preload library has to wait for the event link
+	if ((fd = open_js(0)) < 0)
+		return fail("open");
+	if (link_js(0, 0) < 0)
+		return -1;
+	errors += expect_name(fd, "Fake Stick", "unplug") < 0;
+	if (link_js(0, 1) < 0)
+		return -1;
+	errors += expect_name(fd, "Fake Stick S000", "replug") < 0;
+	close(fd);
+	return errors ? -1 : 0;
+}
+
+
+
+static int child(const char *mode, int count)
+{
+	if (!strcmp(mode, "noop"))
+		return 0;
+	if (!strcmp(mode, "check"))
+		return check(count) < 0;
+	if (!strcmp(mode, "read")) {
+		char buf[4096];
+		int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0)
+			return fail("inotify_init1"), 1;
+		double t = now_us();
+		for (int i = 0; i < CALLS; i++)
+			if (read(fd, buf, sizeof(buf)) >= 0)
+				return fail("read"), 1;
+		printf("%f\n", (now_us() - t) * 1e3 / CALLS);
+		close(fd);
+		return 0;
+	}
+
+	char name[128];
+	int fd = open_js(0);
+	if (fd < 0)
+		return fail("open"), 1;
+
+	double t = now_us();
+	if (!strcmp(mode, "first")) {
+		ioctl(fd, JSIOCGNAME(sizeof(name)), name);
+		printf("%f\n", now_us() - t);
+
+	} else if (!strcmp(mode, "calls")) {
+		ioctl(fd, JSIOCGNAME(sizeof(name)), name);
+		t = now_us();
+		for (int i = 0; i < CALLS; i++)
+			ioctl(fd, JSIOCGNAME(sizeof(name)), name);
+		printf("%f\n", (now_us() - t) * 1e3 / CALLS);
+	}
+	close(fd);
+	return 0;
+}
+
+
+
+// --- parent side -----------------------------------------------------------
+
+// Runs "jsbench --child mode count" with the given LD_PRELOAD. Returns the
+// number it printed (0 if none), or -1 if it failed.
+static double run(const char *libs, const char *mode, int count)
+{
+	int pipefd[2];
+	if (pipe(pipefd) < 0)
+		return fail("pipe");
+
+	pid_t pid = fork();
+	if (pid < 0)
+		return fail("fork");
+	if (pid == 0) {
+		char num[16];
+		snprintf(num, sizeof(num), "%d", count);
+		dup2(pipefd[1], STDOUT_FILENO);
+		close(pipefd[0]);
+		close(pipefd[1]);
+		setenv("LD_PRELOAD", libs, 1);
+		execl(self, self, "--child", mode, num, (char *)NULL);
+		perror("execl");
+		_exit(127);
+	}
+
+	close(pipefd[1]);
+	char buf[64] = "";
+	ssize_t len = read(pipefd[0], buf, sizeof(buf) - 1);
+	close(pipefd[0]);
+	buf[len > 0 ? len : 0] = '\0';
+
+	int status;
+	if (waitpid(pid, &status, 0) < 0)
+		return fail("waitpid");
+	if (!WIFEXITED(status) || WEXITSTATUS(status))
+		return -1;
+	return atof(buf);
+}
+
+
+
+static int remove_entry(const char *path, const struct stat *s, int flag, struct FTW *f)
+{
+	(void)s, (void)flag, (void)f;
+	return remove(path);
+}
+
+
+
+static void remove_cache(void)
+{
+	char pattern[PATH_MAX + 16];
+	glob_t g;
+	snprintf(pattern, sizeof(pattern), "%s/*.cache", root);
+	if (glob(pattern, 0, NULL, &g) == 0) {
+		for (size_t i = 0; i < g.gl_pathc; i++)
+			if (unlink(g.gl_pathv[i]) < 0)
+				perror(g.gl_pathv[i]);
+		globfree(&g);
+	}
+}
+
+
+
+static int make_tree(int count)
+{
+	snprintf(root, sizeof(root), "%s/jsbench.XXXXXX", getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp");
+	if (!mkdtemp(root))
+		return fail("mkdtemp");
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/by-id", root);
+	if (mkdir(path, 0755) < 0)
+		return fail(path);
+
+	for (int n = 0; n < count; n++) {
+		for (int event = 0; event < 2; event++) {
+			snprintf(path, sizeof(path), "%s/%s%d", root, event ? "event" : "js", n);
+			int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0 || ftruncate(fd, event ? 1025 + n : 1 + n) < 0)
+				return fail(path);
+			close(fd);
+		}
+		if (link_js(n, 1) < 0)
+			return -1;
+	}
+
+	setenv("JS_SERIAL_PRELOAD_ROOT", root, 1);
+	setenv("XDG_RUNTIME_DIR", root, 1); // keep the cache inside the tree
+	return 0;
+}
+
+
+
+static double average(const char *libs, const char *mode, int count, int runs, int cold)
+{
+	double sum = 0.0;
+	for (int i = 0; i < runs; i++) {
+		if (cold)
+			remove_cache();
+		double t = now_us();
+		double r = run(libs, mode, count);
+		if (r < 0)
+			return -1;
+		sum += strcmp(mode, "noop") ? r : now_us() - t;
+	}
+	return sum / runs;
+}
+
+
+
+static int over_budget(int count, const char *what, double value, double budget)
+{
+	if (value <= budget)
+		return 0;
+	fprintf(stderr, "FAIL: %d joystick(s): %s %.1f over budget %.1f\n", count, what, value, budget);
+	return 1;
+}
+
+
+
+static int bench(int count)
+{
+	static double base_call = 0.0; // preload JSIOCGNAME with the fewest joysticks
+	static int base_count = 0;
+
+	if (count < 1 || count > 256) {
+		fprintf(stderr, "number of joysticks must be 1..256\n");
+		return -1;
+	}
+
+	int ret = make_tree(count);
+	if (ret == 0 && run(preload, "check", count) < 0) {
+		fprintf(stderr, "FAIL: %d joystick(s)\n", count);
+		ret = -1;
+	}
+
+	if (ret == 0) {
+		remove_cache();
+		run(preload, "first", count); // write the cache
+		double r[] = {
+			average(shim, "noop", count, EXEC_RUNS, 0),
+			average(preload, "noop", count, EXEC_RUNS, 0),
+			average(preload, "first", count, FIRST_RUNS, 1),
+			average(preload, "first", count, FIRST_RUNS, 0),
+			average(shim, "calls", count, 1, 0),
+			average(preload, "calls", count, 1, 0),
+			average(shim, "read", count, 1, 0),
+		};
+		printf("%9d %11.1f %11.1f %11.1f %11.1f %11.1f %11.1f %11.1f\n", count, r[0], r[1], r[2], r[3], r[4],
+				r[5], r[6]);
+		for (size_t i = 0; i < sizeof(r) / sizeof(*r); i++)
+			if (r[i] < 0)
+				ret = -1;
+
+		if (ret == 0) {
+			int over = over_budget(count, "exec [us]", r[1], EXEC_BUDGET * r[0])
+					+ over_budget(count, "cached first JSIOCGNAME [us]", r[3], r[2])
+					+ over_budget(count, "JSIOCGNAME [ns]", r[5], r[4] + CALL_BUDGET * r[6]);
+			if (!base_count || count < base_count) {
+				base_call = r[5];
+				base_count = count;
+			} else if (count > base_count) {
+				over += over_budget(count, "JSIOCGNAME [ns]", r[5], SCALE_BUDGET * base_call);
+			}
+			if (over)
+				ret = -1;
+		}
+	}
+
+	if (root[0] && nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS) < 0)
+		perror("nftw");
+	return ret;
+}
+
+
+
+int main(int argc, char *argv[])
+{
+	if (argc == 4 && !strcmp(argv[1], "--child")) {
+		const char *r = getenv("JS_SERIAL_PRELOAD_ROOT");
+		snprintf(root, sizeof(root), "%s", r ? r : "");
+		return child(argv[2], atoi(argv[3]));
+	}
+
+	if (!realpath("/proc/self/exe", self)) {
+		perror("realpath");
+		return EXIT_FAILURE;
+	}
+	char dir[PATH_MAX];
+	strcpy(dir, self);
+	dirname(dir);
+	snprintf(shim, sizeof(shim), "%s/fake_input.so", dir);
+	snprintf(preload, sizeof(preload), "%s/js_serial_preload.so:%s", dir, shim);
+	unsetenv("LD_PRELOAD");
+
+	printf("                    exec [us]         first JSIOCGNAME [us]       JSIOCGNAME [ns]\n");
+	printf("joysticks        shim     preload        cold      cached        shim     preload   read [ns]\n");
+
+	static const int defaults[] = { 1, 16, 256 };
+	int errors = 0, num = argc > 1 ? argc - 1 : 3;
+	for (int i = 0; i < num; i++)
+		errors += bench(argc > 1 ? atoi(argv[i + 1]) : defaults[i]) < 0;
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -19,10 +19,42 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <linux/joystick.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#define JSDIR "/dev/input/"
+#define MAXJS 32
+#define NUM_BUCKETS 10 // latency histogram: 0, 1, 2-3, 4-7, ..., 128-255, >= 256 ms
+
+
+struct jsstate {
+	char path[PATH_MAX];
+	char name[256];
+	int fd;
+	unsigned char numaxes, numbuttons;
+	unsigned long axis_events[256];
+	unsigned long button_events[256];
+	int32_t *offsets;   // read time - event time, in ms, for each event
+	size_t num_offsets, max_offsets;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+
+
+static void interrupt_handler(int sig)
+{
+	(void)sig;
+	interrupted = 1;
+}
+
+
 
 static int is_js_file(const struct dirent *d)
 {
@@ -32,17 +64,26 @@ static int is_js_file(const struct dirent *d)
 
 
 
-int main(void)
+static uint32_t now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+
+
+static void list_joysticks(void)
 {
 	struct dirent **joysticks;
-	int n = scandir("/dev/input/", &joysticks, is_js_file, alphasort);
+	int n = scandir(JSDIR, &joysticks, is_js_file, alphasort);
 	if (n < 0) {
-		perror("scandir /dev/input/");
+		perror("scandir "JSDIR);
 	} else {
 		int i;
 		for (i = 0; i < n; i++) {
 			char path[PATH_MAX];
-			snprintf(path, PATH_MAX, "/dev/input/%s", joysticks[i]->d_name);
+			snprintf(path, PATH_MAX, JSDIR"%s", joysticks[i]->d_name);
 			free(joysticks[i]);
 
 			int fd = open(path, O_RDONLY);
@@ -67,5 +108,233 @@ int main(void)
 		}
 		free(joysticks);
 	}
-	return 0;
+}
+
+
+
+static int open_joysticks(struct jsstate *js)
+{
+	struct dirent **files;
+	int n = scandir(JSDIR, &files, is_js_file, alphasort);
+	if (n < 0) {
+		perror("scandir "JSDIR);
+		return 0;
+	}
+
+	int num = 0;
+	for (int i = 0; i < n; i++) {
+		if (num == MAXJS) {
+			free(files[i]);
+			continue;
+		}
+
+		struct jsstate *j = &js[num];
+		snprintf(j->path, PATH_MAX, JSDIR"%s", files[i]->d_name);
+		free(files[i]);
+
+		if ((j->fd = open(j->path, O_RDONLY | O_NONBLOCK)) < 0) {
+			perror(j->path);
+			continue;
+		}
+
+		ioctl(j->fd, JSIOCGAXES, &j->numaxes);
+		ioctl(j->fd, JSIOCGBUTTONS, &j->numbuttons);
+		if (ioctl(j->fd, JSIOCGNAME(sizeof(j->name)), j->name) < 0)
+			strcpy(j->name, "?");
+		num++;
+	}
+	free(files);
+	return num;
+}
+
+
+
+static void add_offset(struct jsstate *j, int32_t offset)
+{
+	if (j->num_offsets == j->max_offsets) {
+		size_t max = j->max_offsets ? 2 * j->max_offsets : 4096;
+		int32_t *p = (int32_t *)realloc(j->offsets, max * sizeof(int32_t));
+		if (p == NULL)
+			return;
+		j->offsets = p;
+		j->max_offsets = max;
+	}
+	j->offsets[j->num_offsets++] = offset;
+}
+
+
+
+static void read_events(struct jsstate *j)
+{
+	struct js_event ev[64];
+	ssize_t len;
+	while ((len = read(j->fd, ev, sizeof(ev))) > 0) {
+		uint32_t now = now_ms();
+		for (size_t i = 0; i < len / sizeof(ev[0]); i++) {
+			if (ev[i].type & JS_EVENT_INIT) // initial state, not an event
+				continue;
+			if (ev[i].type & JS_EVENT_AXIS)
+				j->axis_events[ev[i].number]++;
+			else if (ev[i].type & JS_EVENT_BUTTON)
+				j->button_events[ev[i].number]++;
+			add_offset(j, (int32_t)(now - ev[i].time)); // both wrap after 49.7 days
+		}
+	}
+}
+
+
+
+static void print_bar(const char *label, unsigned long n, unsigned long max)
+{
+	int width = max ? (int)(50 * n / max) : 0;
+	fprintf(stderr, "  %10s %8lu  ", label, n);
+	while (width--)
+		fputc('#', stderr);
+	fputc('\n', stderr);
+}
+
+
+
+// The event time is the kernel's jiffies-based millisecond clock, whose
+// offset to CLOCK_MONOTONIC is unknown. The smallest observed difference
+// is taken as that offset, so the histogram shows the delay on top of the
+// fastest delivery (jitter), not absolute latency.
+static void print_latency(const struct jsstate *j)
+{
+	if (!j->num_offsets) {
+		fprintf(stderr, "  no events\n");
+		return;
+	}
+
+	int32_t min = j->offsets[0], max = j->offsets[0];
+	for (size_t i = 1; i < j->num_offsets; i++) {
+		if (j->offsets[i] < min)
+			min = j->offsets[i];
+		if (j->offsets[i] > max)
+			max = j->offsets[i];
+	}
+
+	unsigned long buckets[NUM_BUCKETS] = {0}, top = 0;
+	double sum = 0;
+	for (size_t i = 0; i < j->num_offsets; i++) {
+		uint32_t d = j->offsets[i] - min;
+		int b = 0;
+		while (d && b < NUM_BUCKETS - 1) {
+			d >>= 1;
+			b++;
+		}
+		buckets[b]++;
+		sum += j->offsets[i] - min;
+	}
+	for (int b = 0; b < NUM_BUCKETS; b++)
+		if (buckets[b] > top)
+			top = buckets[b];
+
+	fprintf(stderr, "  jitter: mean %.2f ms, max %d ms (%zu events)\n",
+			sum / j->num_offsets, (int)(max - min), j->num_offsets);
+	for (int b = 0; b < NUM_BUCKETS; b++) {
+		char label[32];
+		int lo = b ? 1 << (b - 1) : 0, hi = (1 << b) - 1;
+		if (b == NUM_BUCKETS - 1)
+			snprintf(label, sizeof(label), ">= %d ms", lo);
+		else if (lo >= hi)
+			snprintf(label, sizeof(label), "%d ms", lo);
+		else
+			snprintf(label, sizeof(label), "%d-%d ms", lo, hi);
+		print_bar(label, buckets[b], top);
+	}
+}
+
+
+
+static void print_rates(const char *what, const unsigned long *events, int num, double seconds)
+{
+	unsigned long top = 0;
+	for (int i = 0; i < num; i++)
+		if (events[i] > top)
+			top = events[i];
+	if (!top)
+		return;
+
+	fprintf(stderr, "  %s events per second:\n", what);
+	for (int i = 0; i < num; i++) {
+		if (!events[i])
+			continue;
+		char label[32];
+		snprintf(label, sizeof(label), "%c%d %.1f/s", what[0] == 'a' ? 'A' : 'B', i,
+				events[i] / seconds);
+		print_bar(label, events[i], top);
+	}
+}
+
+
+
+// Reads events from all joysticks for the given time (or until Ctrl-c) and
+// prints event jitter and per axis/button event rates.
+static int measure_latency(double seconds)
+{
+	static struct jsstate js[MAXJS];
+	int num = open_joysticks(js);
+	if (!num) {
+		fprintf(stderr, "no joysticks found\n");
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, interrupt_handler);
+	signal(SIGTERM, interrupt_handler);
+
+	struct pollfd fds[MAXJS];
+	for (int i = 0; i < num; i++) {
+		fds[i].fd = js[i].fd;
+		fds[i].events = POLLIN;
+		read_events(&js[i]); // discard the JS_EVENT_INIT burst
+		js[i].num_offsets = 0;
+	}
+
+	fprintf(stderr, "reading events from %d joystick%s for %g s ...\n", num, num == 1 ? "" : "s", seconds);
+	uint32_t start = now_ms(), duration = (uint32_t)(seconds * 1000);
+	uint32_t elapsed;
+	while (!interrupted && (elapsed = now_ms() - start) < duration) {
+		int ret = poll(fds, num, duration - elapsed);
+		if (ret < 0)
+			continue; // EINTR
+		for (int i = 0; i < num; i++)
+			if (fds[i].revents & POLLIN)
+				read_events(&js[i]);
+	}
+	seconds = (now_ms() - start) / 1000.0;
+
+	for (int i = 0; i < num; i++) {
+		fprintf(stderr, "\n%s:\t\"%s\"  (%d axes, %d buttons)\n", js[i].path, js[i].name,
+				(int)js[i].numaxes, (int)js[i].numbuttons);
+		print_latency(&js[i]);
+		print_rates("axis", js[i].axis_events, 256, seconds);
+		print_rates("button", js[i].button_events, 256, seconds);
+		free(js[i].offsets);
+		close(js[i].fd);
+	}
+	return EXIT_SUCCESS;
+}
+
+
+
+int main(int argc, char *argv[])
+{
+	if (argc == 1) {
+		list_joysticks();
+		return 0;
+	}
+
+	if (argc == 2 && !strncmp(argv[1], "--latency", 9) && (!argv[1][9] || argv[1][9] == '=')) {
+		double seconds = argv[1][9] ? atof(argv[1] + 10) : 10.0;
+		if (seconds <= 0) {
+			fprintf(stderr, "invalid number of seconds: %s\n", argv[1] + 10);
+			return EXIT_FAILURE;
+		}
+		return measure_latency(seconds);
+	}
+
+	fprintf(stderr, "Usage: lsjs [--latency[=SECONDS]]\n");
+	fprintf(stderr, "  list joysticks, or measure event jitter and rates (default: 10 s)\n");
+	return EXIT_FAILURE;
 }
@@ -0,0 +1,310 @@
+// libbu0836 C API
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#include <iostream>
+#include <string>
+
+#include "bu0836.hxx"
+#include "libbu0836.h"
+#include "logging.hxx"
+#include "simulator.hxx"
+
+using namespace std;
+using namespace logging;
+
+
+
+struct bu0836_context {
+	explicit bu0836_context(bu0836::transport *t = 0) : manager(t) {}
+	bu0836::manager manager;
+};
+
+
+
+namespace {
+
+// No exception must leave the C API. Call from a catch block only.
+int error(const char *function)
+{
+	try {
+		throw;
+	} catch (const string &msg) {
+		log(ALERT) << function << ": " << msg << endl;
+	} catch (const char *msg) {
+		log(ALERT) << function << ": " << msg << endl;
+	} catch (...) {
+		log(ALERT) << function << ": unexpected exception" << endl;
+	}
+	return -1;
+}
+
+
+
+inline bu0836::controller *controller(bu0836_device *dev)
+{
+	return reinterpret_cast<bu0836::controller *>(dev);
+}
+
+
+
+inline const bu0836::controller *controller(const bu0836_device *dev)
+{
+	return reinterpret_cast<const bu0836::controller *>(dev);
+}
+
+
+
+int require_config(bu0836::controller *c)
+{
+	if (c->claim() || c->require_eeprom(bu0836::EEPROM_CONFIG_FIRST, bu0836::EEPROM_CONFIG_LAST))
+		return -1;
+	return 0;
+}
+
+
+
+struct stream_callback {
+	bu0836_state_callback callback;
+	void *data;
+};
+
+
+
+bool call_stream_callback(const bu0836::state &s, void *data)
+{
+	stream_callback *cb = static_cast<stream_callback *>(data);
+	return cb->callback(&s, cb->data) != 0;
+}
+
+} // namespace
+
+
+
+void bu0836_set_log_level(int level)
+{
+	set_log_level(level);
+}
+
+
+
+int bu0836_open(bu0836_context **ctx) try
+{
+	*ctx = 0;
+	*ctx = new bu0836_context;
+	return 0;
+
+} catch (...) {
+	return error("bu0836_open");
+}
+
+
+
+int bu0836_open_simulated(bu0836_context **ctx, int num) try
+{
+	*ctx = 0;
+	if (num < 1)
+		throw string("number of devices must be positive");
+	bu0836::simulator::config cfg;
+	cfg.boards = num;
+	*ctx = new bu0836_context(new bu0836::simulator(cfg));
+	return 0;
+
+} catch (...) {
+	return error("bu0836_open_simulated");
+}
+
+
+
+void bu0836_close(bu0836_context *ctx)
+{
+	delete ctx;
+}
+
+
+
+int bu0836_count(const bu0836_context *ctx)
+{
+	return ctx->manager.size();
+}
+
+
+
+bu0836_device *bu0836_get_device(bu0836_context *ctx, int index)
+{
+	if (index < 0 || size_t(index) >= ctx->manager.size())
+		return 0;
+	return reinterpret_cast<bu0836_device *>(&ctx->manager[index]);
+}
+
+
+
+bu0836_device *bu0836_find(bu0836_context *ctx, const char *which)
+{
+	if (ctx->manager.select(which) != 1)
+		return 0;
+	return reinterpret_cast<bu0836_device *>(ctx->manager.selected());
+}
+
+
+
+const char *bu0836_bus_address(const bu0836_device *dev)
+{
+	return controller(dev)->bus_address().c_str();
+}
+
+
+
+const char *bu0836_manufacturer(const bu0836_device *dev)
+{
+	return controller(dev)->manufacturer().c_str();
+}
+
+
+
+const char *bu0836_product(const bu0836_device *dev)
+{
+	return controller(dev)->product().c_str();
+}
+
+
+
+const char *bu0836_serial(const bu0836_device *dev)
+{
+	return controller(dev)->serial().c_str();
+}
+
+
+
+const char *bu0836_release(const bu0836_device *dev)
+{
+	return controller(dev)->release().c_str();
+}
+
+
+
+const char *bu0836_name(const bu0836_device *dev)
+{
+	return controller(dev)->jsid().c_str();
+}
+
+
+
+int bu0836_capabilities(const bu0836_device *dev)
+{
+	return controller(dev)->capabilities();
+}
+
+
+
+int bu0836_active_axes(bu0836_device *dev) try
+{
+	bu0836::controller *c = controller(dev);
+	if (c->claim() || c->require_layout())
+		return -1;
+	return c->active_axes();
+
+} catch (...) {
+	return error("bu0836_active_axes");
+}
+
+
+
+int bu0836_get_config(bu0836_device *dev, bu0836_config *cfg) try
+{
+	bu0836::controller *c = controller(dev);
+	if (require_config(c))
+		return -1;
+
+	cfg->invert = cfg->shutoff = 0;
+	for (int i = 0; i < BU0836_MAX_AXES; i++) {
+		cfg->invert |= c->get_invert(i) << i;
+		cfg->shutoff |= c->get_shutoff(i) << i;
+		cfg->zoom[i] = c->get_zoom(i);
+	}
+	for (int i = 0; i < BU0836_MAX_BUTTONS / 2; i++)
+		cfg->encoder[i] = c->get_encoder_mode(i * 2);
+	cfg->autodiscovery = c->get_autodiscovery();
+	cfg->pulse_width = c->get_pulse_width();
+	return 0;
+
+} catch (...) {
+	return error("bu0836_get_config");
+}
+
+
+
+int bu0836_set_config(bu0836_device *dev, const bu0836_config *cfg) try
+{
+	bu0836::controller *c = controller(dev);
+	if (require_config(c))
+		return -1;
+
+	bu0836_config current;
+	bu0836_get_config(dev, &current);
+	int needed = 0;
+	if (cfg->invert != current.invert || cfg->shutoff != current.shutoff)
+		needed |= bu0836::INVERT;
+	for (int i = 0; i < BU0836_MAX_AXES; i++)
+		if (cfg->zoom[i] != current.zoom[i])
+			needed |= bu0836::ZOOM;
+	for (int i = 0; i < BU0836_MAX_BUTTONS / 2; i++)
+		if ((cfg->encoder[i] & 3) != current.encoder[i])
+			needed |= (cfg->encoder[i] & 3) > 1 ? bu0836::ENCODER2 : bu0836::ENCODER1;
+	if (cfg->pulse_width != current.pulse_width)
+		needed |= bu0836::ENCODER1;
+	if ((c->capabilities() & needed) != needed) {
+		log(ALERT) << "bu0836_set_config: device '" << c->serial() << "' doesn't support this configuration"
+				<< endl;
+		return -1;
+	}
+
+	for (int i = 0; i < BU0836_MAX_AXES; i++) {
+		bool invert = cfg->invert & (1 << i), shutoff = cfg->shutoff & (1 << i);
+		if (c->get_invert(i) != invert)
+			c->set_invert(i, invert);
+		if (c->get_shutoff(i) != shutoff)
+			c->set_shutoff(i, shutoff);
+		if (c->get_zoom(i) != cfg->zoom[i])
+			c->set_zoom(i, cfg->zoom[i]);
+	}
+	for (int i = 0; i < BU0836_MAX_BUTTONS / 2; i++)
+		if (c->get_encoder_mode(i * 2) != (cfg->encoder[i] & 3))
+			c->set_encoder_mode(i * 2, cfg->encoder[i] & 3);
+	if (c->get_autodiscovery() != (cfg->autodiscovery != 0))
+		c->set_autodiscovery(cfg->autodiscovery);
+	if (c->get_pulse_width() != cfg->pulse_width)
+		c->set_pulse_width(cfg->pulse_width);
+	return c->sync() ? -1 : 0;
+
+} catch (...) {
+	return error("bu0836_set_config");
+}
+
+
+
+int bu0836_stream(bu0836_device *dev, bu0836_state_callback callback, void *data) try
+{
+	bu0836::controller *c = controller(dev);
+	stream_callback cb = { callback, data };
+	if (c->claim() || c->read_input_reports(call_stream_callback, &cb))
+		return -1;
+	return 0;
+
+} catch (...) {
+	return error("bu0836_stream");
+}
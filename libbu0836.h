@@ -0,0 +1,127 @@
+// libbu0836 C API
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#ifndef _LIBBU0836_H_
+#define _LIBBU0836_H_
+
+/*
+In-process access to BU0836 controllers, without the bu0836 executable:
+
+	struct bu0836_context *ctx;
+	if (bu0836_open(&ctx))
+		return 1;
+
+	struct bu0836_device *dev = bu0836_find(ctx, "A12107");  // or bu0836_get_device(ctx, 0)
+	struct bu0836_config cfg;
+	if (dev && !bu0836_get_config(dev, &cfg)) {
+		cfg.invert |= 1 << 2;                                 // invert axis 2
+		bu0836_set_config(dev, &cfg);                         // writes the EEPROM
+		bu0836_stream(dev, callback, user_data);
+	}
+	bu0836_close(ctx);
+
+All functions that return int return 0 on success and a negative number on
+failure. Error messages go to stderr (see bu0836_set_log_level()). Devices
+belong to their context and are only valid until bu0836_close(). Only one
+context should be open at a time, and a context must only be used by one
+thread at a time.
+*/
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BU0836_API __attribute__((visibility("default")))
+
+#define BU0836_MAX_AXES 8
+#define BU0836_MAX_BUTTONS 32
+
+/* device capabilities (same as bu0836::capabilities) */
+#define BU0836_INVERT   0x1
+#define BU0836_ZOOM     0x2
+#define BU0836_ENCODER1 0x4   /* 1:1 encoder */
+#define BU0836_ENCODER2 0x8   /* 1:2 and 1:4 encoder */
+
+struct bu0836_context;
+struct bu0836_device;
+
+/* the configuration part of the EEPROM */
+struct bu0836_config {
+	uint8_t invert;                            /* bitmask of inverted axes */
+	uint8_t shutoff;                           /* bitmask of shut off axes */
+	uint8_t autodiscovery;                     /* 0 or 1 */
+	uint8_t zoom[BU0836_MAX_AXES];             /* 0 = off */
+	uint8_t encoder[BU0836_MAX_BUTTONS / 2];   /* mode of buttons 2n and 2n+1: 0 = off, 1 = 1:1,
+	                                              2 = 1:2, 3 = 1:4 */
+	uint8_t pulse_width;                       /* 1-11, in units of 8 ms */
+};
+
+/* a decoded input report */
+struct bu0836_state {
+	uint32_t axes;                             /* bitmask of the axes in the report */
+	uint32_t axis[BU0836_MAX_AXES];            /* raw values, 0 .. axis_max */
+	uint32_t axis_max[BU0836_MAX_AXES];        /* logical maximum */
+	uint32_t buttons;                          /* bit n = button n pressed */
+	int num_buttons;
+	int hat;                                   /* -1 if there's none */
+};
+
+/* returns nonzero to receive the next state, 0 to stop */
+typedef int (*bu0836_state_callback)(const struct bu0836_state *state, void *data);
+
+/* 1 (everything) .. 5 (only errors; default) */
+BU0836_API void bu0836_set_log_level(int level);
+
+/* enumerates the connected controllers */
+BU0836_API int bu0836_open(struct bu0836_context **ctx);
+/* same with simulated BU0836A controllers instead of USB (for tests) */
+BU0836_API int bu0836_open_simulated(struct bu0836_context **ctx, int num);
+BU0836_API void bu0836_close(struct bu0836_context *ctx);
+
+BU0836_API int bu0836_count(const struct bu0836_context *ctx);
+BU0836_API struct bu0836_device *bu0836_get_device(struct bu0836_context *ctx, int index);
+
+/* by bus address ("3:12") or (ending of) serial number; NULL unless exactly one matches */
+BU0836_API struct bu0836_device *bu0836_find(struct bu0836_context *ctx, const char *which);
+
+BU0836_API const char *bu0836_bus_address(const struct bu0836_device *dev);
+BU0836_API const char *bu0836_manufacturer(const struct bu0836_device *dev);
+BU0836_API const char *bu0836_product(const struct bu0836_device *dev);
+BU0836_API const char *bu0836_serial(const struct bu0836_device *dev);
+BU0836_API const char *bu0836_release(const struct bu0836_device *dev);
+BU0836_API const char *bu0836_name(const struct bu0836_device *dev);   /* as JSIOCGNAME with js_serial_preload */
+BU0836_API int bu0836_capabilities(const struct bu0836_device *dev);
+
+/* the functions below claim the device from the kernel driver on first use */
+BU0836_API int bu0836_active_axes(struct bu0836_device *dev);         /* bitmask, or < 0 */
+BU0836_API int bu0836_get_config(struct bu0836_device *dev, struct bu0836_config *cfg);
+
+/* only writes (and verifies) what differs from the device's configuration; fails
+   without writing anything if that needs a capability that the device doesn't have */
+BU0836_API int bu0836_set_config(struct bu0836_device *dev, const struct bu0836_config *cfg);
+
+/* calls the callback with every input report until it returns 0 */
+BU0836_API int bu0836_stream(struct bu0836_device *dev, bu0836_state_callback callback, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
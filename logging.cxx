@@ -16,12 +16,15 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 //
-#include <cstring>     // strcmp
+#include <cerrno>
+#include <cstring>     // strcmp, memcpy
 #include <iomanip>
 #include <iostream>
+#include <pthread.h>
 #include <stdlib.h>    // getenv, STDOUT_FILENO
 #include <sstream>
-#include <unistd.h>    // isatty
+#include <time.h>      // nanosleep
+#include <unistd.h>    // isatty, write
 
 #include "logging.hxx"
 
@@ -48,12 +51,294 @@ ostream cnull(&nb);
 
 bool cout_color = has_color(STDOUT_FILENO);
 bool cerr_color = has_color(STDERR_FILENO);
-int log_level = ALERT;
+
+
+
+// Log output is formatted into a per-thread line buffer, queued in a fixed
+// ring of slots and written to stderr by a background thread in large
+// chunks. A line takes as many consecutive slots as it needs, reserved at
+// once, so that it is never interleaved with other threads' lines or cut
+// short. If the ring is full, the line is dropped and counted; nobody waits.
+// ALERT and above are written directly instead, with one write(2). The ring is a bounded multi-
+// producer queue with a sequence number per slot (after D. Vyukov), with the
+// flusher as only consumer. The flusher sleeps on a condition variable while
+// the ring is empty; producers only touch the mutex to wake it.
+const unsigned int SLOTS = 1024; // power of two
+const unsigned int SLOT_SIZE = 240;
+const unsigned int LINE_SLOTS = 16;  // longer lines are split
+
+struct slot {
+	unsigned long seq;
+	unsigned int len;
+	char data[SLOT_SIZE];
+};
+
+slot ring[SLOTS];
+unsigned long enqueue_pos = 0;
+unsigned long dequeue_pos = 0;   // flusher thread only
+unsigned long written_pos = 0;   // everything before this is on stderr
+unsigned long dropped = 0;
+
+enum { IDLE, RUNNING, STOPPED };
+int state = IDLE;
+
+int sleeping = 0;                // flusher waits on wakeup
+pthread_mutex_t wakeup_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+
+pthread_once_t start_once = PTHREAD_ONCE_INIT;
+pthread_key_t stream_key;
+pthread_t flusher;
+
+
+
+void wake_flusher()
+{
+	pthread_mutex_lock(&wakeup_mutex);
+	pthread_cond_signal(&wakeup);
+	pthread_mutex_unlock(&wakeup_mutex);
+}
+
+
+
+// Returns false if the ring is full.
+bool enqueue(const char *data, unsigned int len)
+{
+	unsigned long n = (len + SLOT_SIZE - 1) / SLOT_SIZE;
+	unsigned long pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+	while (1) {
+		// slots are freed in order, so if the last one is free, all are
+		slot &last = ring[(pos + n - 1) & (SLOTS - 1)];
+		long diff = long(__atomic_load_n(&last.seq, __ATOMIC_ACQUIRE) - (pos + n - 1));
+		if (!diff) {
+			if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + n, true,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				for (unsigned long i = 0; i < n; i++) {
+					slot &s = ring[(pos + i) & (SLOTS - 1)];
+					s.len = len - i * SLOT_SIZE < SLOT_SIZE ? len - i * SLOT_SIZE : SLOT_SIZE;
+					memcpy(s.data, data + i * SLOT_SIZE, s.len);
+					__atomic_store_n(&s.seq, pos + i + 1, __ATOMIC_RELEASE);
+				}
+				// pairs with the fence in flush_loop(): either the flusher sees
+				// this slot, or we see it sleeping
+				__atomic_thread_fence(__ATOMIC_SEQ_CST);
+				if (__atomic_load_n(&sleeping, __ATOMIC_RELAXED))
+					wake_flusher();
+				return true;
+			}
+		} else if (diff < 0) { // full
+			return false;
+		} else {
+			pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+
+
+void write_all(const char *p, size_t len)
+{
+	while (len) {
+		ssize_t n = write(STDERR_FILENO, p, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		p += n, len -= n;
+	}
+}
+
+
+
+bool queued()
+{
+	slot &s = ring[dequeue_pos & (SLOTS - 1)];
+	return __atomic_load_n(&s.seq, __ATOMIC_ACQUIRE) == dequeue_pos + 1;
+}
+
+
+
+// moves everything queued so far to stderr; returns false if there was nothing
+bool drain()
+{
+	static char out[32 * 1024];
+	static unsigned long reported = 0;
+	size_t len = 0;
+	bool any = false;
+
+	while (1) {
+		slot &s = ring[dequeue_pos & (SLOTS - 1)];
+		if (__atomic_load_n(&s.seq, __ATOMIC_ACQUIRE) != dequeue_pos + 1)
+			break;
+		if (len + s.len > sizeof(out)) {
+			write_all(out, len);
+			len = 0;
+		}
+		memcpy(out + len, s.data, s.len);
+		len += s.len;
+		__atomic_store_n(&s.seq, dequeue_pos + SLOTS, __ATOMIC_RELEASE);
+		dequeue_pos++;
+		any = true;
+	}
+
+	// the notice only goes between lines (the rest of a line may not be
+	// published yet)
+	static bool at_eol = true;
+	if (len)
+		at_eol = out[len - 1] == '\n';
+	unsigned long d = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+	if (d != reported && at_eol) {
+		ostringstream x;
+		x << "[" << d - reported << " log messages dropped]" << endl;
+		reported = d;
+		if (len + x.str().size() > sizeof(out)) {
+			write_all(out, len);
+			len = 0;
+		}
+		memcpy(out + len, x.str().data(), x.str().size());
+		len += x.str().size();
+	}
+
+	write_all(out, len);
+	__atomic_store_n(&written_pos, dequeue_pos, __ATOMIC_RELEASE);
+	return any;
+}
+
+
+
+void *flush_loop(void *)
+{
+	while (__atomic_load_n(&state, __ATOMIC_ACQUIRE) == RUNNING) {
+		if (drain())
+			continue;
+
+		pthread_mutex_lock(&wakeup_mutex);
+		__atomic_store_n(&sleeping, 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (!queued() && __atomic_load_n(&state, __ATOMIC_ACQUIRE) == RUNNING)
+			pthread_cond_wait(&wakeup, &wakeup_mutex);
+		__atomic_store_n(&sleeping, 0, __ATOMIC_RELAXED);
+		pthread_mutex_unlock(&wakeup_mutex);
+	}
+	return 0;
+}
+
+
+
+class line_buf : public streambuf {
+public:
+	line_buf() : _urgent(false), _skip(false) { setp(_buf, _buf + sizeof(_buf)); }
+	~line_buf() { sync(); }
+	void set_urgent(bool urgent) { _urgent = urgent; }
+
+protected:
+	int overflow(int c) {
+		sync();
+		if (c != traits_type::eof()) {
+			*pptr() = c;
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	// Lines longer than the buffer are queued in parts. Once one part is
+	// dropped, the rest of the line is dropped, too, rather than glued to
+	// the next one.
+	int sync() {
+		if (pptr() > pbase()) {
+			if (!_skip && !enqueue(pbase(), pptr() - pbase())) {
+				if (_urgent) {
+					write_all(pbase(), pptr() - pbase());
+				} else {
+					__atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+					_skip = true;
+				}
+			}
+			if (pptr()[-1] == '\n')
+				_skip = false;
+		}
+		setp(_buf, _buf + sizeof(_buf));
+		return 0;
+	}
+
+private:
+	char _buf[SLOT_SIZE * LINE_SLOTS];
+	bool _urgent; // ALERT: written directly instead of dropped
+	bool _skip;   // part of this line was dropped
+};
+
+
+
+struct log_stream {
+	log_stream() : os(&buf) {}
+	line_buf buf;
+	ostream os;
+};
+
+
+
+void delete_stream(void *p)
+{
+	delete static_cast<log_stream *>(p);
+}
+
+
+
+void start()
+{
+	for (unsigned int i = 0; i < SLOTS; i++)
+		ring[i].seq = i;
+	if (pthread_key_create(&stream_key, delete_stream))
+		return;
+	state = RUNNING;
+	if (pthread_create(&flusher, 0, flush_loop, 0))
+		state = STOPPED;
+}
+
+
+
+// the calling thread's log stream (or cerr if there's no flusher thread)
+ostream &stream(int priority = INFO)
+{
+	pthread_once(&start_once, start);
+	if (__atomic_load_n(&state, __ATOMIC_ACQUIRE) != RUNNING)
+		return cerr;
+
+	log_stream *s = static_cast<log_stream *>(pthread_getspecific(stream_key));
+	if (!s) {
+		s = new log_stream;
+		pthread_setspecific(stream_key, s);
+	}
+	s->buf.set_urgent(priority >= ALERT);
+	return s->os;
+}
+
+
+
+// writes out whatever is left at exit; later messages go to cerr directly
+struct shutdown {
+	~shutdown() {
+		if (__atomic_load_n(&state, __ATOMIC_ACQUIRE) != RUNNING)
+			return;
+		log_stream *s = static_cast<log_stream *>(pthread_getspecific(stream_key));
+		if (s)
+			s->os.flush();
+		__atomic_store_n(&state, STOPPED, __ATOMIC_RELEASE);
+		wake_flusher();
+		pthread_join(flusher, 0);
+		drain();
+	}
+} shutdown_on_exit;
 
 } // namespace
 
 
 
+int log_level = ALERT;
+
+
+
 color reset("0");
 color bold("1");
 color underline("4");
@@ -81,7 +366,7 @@ color bg_white("47");
 
 
 ostream &operator<<(ostream &os, const color &c) {
-	if ((os == cerr && cerr_color) || (os == cout && cout_color))
+	if ((os == cout && cout_color) || (cerr_color && (os == cerr || dynamic_cast<line_buf *>(os.rdbuf()))))
 		return os << "\033[" << c._color << 'm';
 	return os;
 }
@@ -113,7 +398,22 @@ void set_log_level(int level)
 
 ostream &log(int priority = ALWAYS)
 {
-	return priority >= log_level ? cerr : cnull;
+	return priority >= log_level ? stream(priority) : cnull;
+}
+
+
+
+void flush()
+{
+	if (__atomic_load_n(&state, __ATOMIC_ACQUIRE) != RUNNING)
+		return;
+
+	stream().flush();
+	unsigned long pos = __atomic_load_n(&enqueue_pos, __ATOMIC_ACQUIRE);
+	const struct timespec ts = {0, 1000000};
+	while (__atomic_load_n(&written_pos, __ATOMIC_ACQUIRE) < pos
+			&& __atomic_load_n(&state, __ATOMIC_ACQUIRE) == RUNNING)
+		nanosleep(&ts, 0);
 }
 
 
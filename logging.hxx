@@ -26,6 +26,11 @@
 #define DO_STRINGIZE(X) #X
 #define ORIGIN __FILE__":"STRINGIZE(__LINE__)": "
 
+// Like log(level), but the operands aren't evaluated at all if the level is
+// disabled. Use this where the arguments are expensive or in hot paths.
+// (The << chain binds tighter than &, which binds tighter than ?:.)
+#define LOG(level) !logging::enabled(level) ? (void)0 : logging::voidify() & logging::log(level)
+
 
 
 namespace logging {
@@ -78,12 +83,23 @@ extern color bg_white;
 
 
 
+// used by LOG() to turn the stream expression into void
+struct voidify {
+	void operator&(std::ostream &) {}
+};
+
+extern int log_level;
+inline bool enabled(int level) { return level >= log_level; }
+
+
+
 std::ostream &operator<<(std::ostream &, const color &);
 std::string operator+(const std::string &, int);
 
 int get_log_level();
 void set_log_level(int);
 std::ostream &log(int log_level);
+void flush(); // waits until all log messages so far are written
 std::string bytes(const unsigned char *p, unsigned int num, size_t width = 0);
 
 } // namespace logging
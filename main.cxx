@@ -16,12 +16,21 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 //
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
+#include <set>
 #include <sstream>
 
 #include "bu0836.hxx"
 #include "logging.hxx"
+#include "metrics.hxx"
 #include "options.h"
+#include "remote.hxx"
+#include "simulator.hxx"
+#include "trace.hxx"
 
 #define EMAIL "<melchior.franz@gmail.com>"
 
@@ -45,18 +54,29 @@ void help(void)
 	cout << "  -h, --help               show this help screen and exit" << endl;
 	cout << "      --version            show version number and exit" << endl;
 	cout << "  -v, --verbose            increase verbosity level (can be used three times)" << endl;
+	cout << "      --trace=FILE         record all USB calls in FILE (Chrome trace event JSON)" << endl;
+	cout << "      --timing             show time and USB calls spent in each phase at exit" << endl;
 	cout << "  -l, --list               list BU0836 devices" << endl;
+	cout << "      --simulate[=NUMBER]  use NUMBER simulated devices (default 1) instead" << endl;
+	cout << "                           of USB" << endl;
+	cout << "      --no-daemon          access USB directly even if bu0836d is running" << endl;
+	cout << "      --batch[=FILE]       run commands from FILE (default: stdin) and write all" << endl;
+	cout << "                           changes once per device at the end (see man page)" << endl;
 	cout << endl;
 	cout << "Device options:" << endl;
 	cout << "  -d, --device=STRING      select device by bus id or (ending of) serial number" << endl;
 	cout << "  -s, --status             show current device configuration" << endl;
 	cout << "  -m, --monitor            monitor device output (terminate with Ctrl-c)" << endl;
+	cout << "      --metrics=FILE       write controller metrics to FILE every 5 s" << endl;
+	cout << "                           (Prometheus text format)" << endl;
 	cout << "  -r, --reset              reset device configuration to \"factory default\"" << endl;
 	cout << "                           (equivalent of -a0-7 -f0 -i0 -z0 -b0-31 -e0 -p6)" << endl;
 	cout << "  -y, --sync               write current changes to the controller's EEPROM" << endl;
 	cout << "  -O, --save=FILE          save EEPROM image buffer to file <s>" << endl;
 	cout << "  -I, --load=FILE          load EEPROM image from file <s> and flash EEPROM" << endl;
 	cout << "  -X, --dump               display EEPROM image buffer" << endl;
+	cout << "      --emit-decoder=FILE  write a C++ header that decodes the device's input" << endl;
+	cout << "                           reports (tested against a few live reports)" << endl;
 	cout << endl;
 	cout << "Axis options:" << endl;
 	cout << "  -a, --axes=LIST          select axes (overrides prior axis selection)" << endl;
@@ -258,10 +278,18 @@ void print_status(bu0836::controller *c)
 
 void commit_changes(bu0836::manager &dev)
 {
+	int failed = 0;
 	for (size_t i = 0; i < dev.size(); i++) {
 		if (!dev[i].is_dirty())
 			continue;
+		if (dev[i].require_layout()) {
+			log(ALERT) << "cannot read HID layout of device '" << dev[i].serial() << "'; changes not written"
+					<< endl;
+			failed++;
+			continue;
+		}
 
+		logging::flush();
 		cerr << endl;
 		print_status(&dev[i]);
 		cout << endl;
@@ -269,16 +297,21 @@ void commit_changes(bu0836::manager &dev)
 		do {
 			cerr << cyan << "Write configuration to controller? [y/N] " << reset;
 			key = cin.get();
-			cin.clear();
-			if (key == '\n')
+			if (key == EOF) // stdin closed or used up (--batch)
+				cerr << endl;
+			if (key == '\n' || key == EOF)
 				key = 'n';
 			else
 				cin.ignore(80, cin.widen('\n'));
-		} while (!cin.fail() && key != 'n' && key != 'N' && key != 'y' && key != 'Y');
+			cin.clear();
+		} while (key != 'n' && key != 'N' && key != 'y' && key != 'Y');
 
-		if (key == 'y' || key == 'Y')
-			dev[i].sync();
+		if ((key == 'y' || key == 'Y') && dev[i].sync())
+			failed++;
 	}
+
+	if (failed)
+		throw string("changes to ") + failed + " device(s) not written";
 }
 
 
@@ -300,291 +333,508 @@ bool boolify(const string &in, const string &err = "bool expected")
 	throw err;
 }
 
-} // namespace
 
 
+enum {
+	HELP_OPTION, VERSION_OPTION, VERBOSE_OPTION, TRACE_OPTION, TIMING_OPTION, METRICS_OPTION,
+	SIMULATE_OPTION, NO_DAEMON_OPTION, BATCH_OPTION,
+	LIST_OPTION, DEVICE_OPTION, STATUS_OPTION, MONITOR_OPTION, RESET_OPTION, SYNC_OPTION,
+	SAVE_OPTION, LOAD_OPTION, DUMP_OPTION, EMIT_DECODER_OPTION,
+	AXES_OPTION, INVERT_OPTION, ZOOM_OPTION, AUTODISCOVERY_OPTION, SHUTOFF_OPTION,
+	BUTTONS_OPTION, ENCODER_OPTION, PULSEWIDTH_OPTION,
+};
+
+const struct command_line_option options[] = {
+	{ "--help",           "-h", 0, "\0" },
+	{ "--version",           0, 0, "\0" },
+	{ "--verbose",        "-v", 0, "\0" },
+	{ "--trace",             0, 1, "\0" },
+	{ "--timing",            0, 0, "\0" },
+	{ "--metrics",           0, 1, "\0" },
+	{ "--simulate",          0, 0, "\0" },  // optional argument
+	{ "--no-daemon",         0, 0, "\0" },
+	{ "--batch",             0, 0, "\0" },  // optional argument
+	{ "--list",           "-l", 0, "\0" },
+	{ "--device",         "-d", 1, "\0" },
+	//
+	{ "--status",         "-s", 0, "dlc" },
+	{ "--monitor",        "-m", 0, "dl" },
+	{ "--reset",          "-r", 0, "dc" },
+	{ "--sync",           "-y", 0, "d"  },
+	{ "--save",           "-O", 1, "d"  },
+	{ "--load",           "-I", 1, "d"  },
+	{ "--dump",           "-X", 0, "de" },
+	{ "--emit-decoder",      0, 1, "dl" },
+	//
+	{ "--axes",           "-a", 1, "\0" },
+	{ "--invert",         "-i", 1, "ac" },
+	{ "--zoom",           "-z", 1, "ac" },
+	{ "--autodiscovery",  "-u", 1, "dc" },
+	{ "--shut-off",       "-f", 1, "ac" },
+	//
+	{ "--buttons",        "-b", 1, "\0" },
+	{ "--encoder",        "-e", 1, "bc" },
+	{ "--pulse-width",    "-p", 1, "bc" },
+	OPTIONS_LAST
+};
+
+// option extensions:
+// "d" ... requires device
+// "a" ... requires axis support & selection
+// "b" ... requires encoder support & button selection
+//
+// followed by the device data that the option needs (fetched on first use):
+// "l" ... HID layout (active axes)
+// "c" ... configuration part of the EEPROM (0x0b-0x1a)
+// "e" ... whole EEPROM
 
-int main(int argc, const char *argv[]) try
-{
-	enum {
-		HELP_OPTION, VERSION_OPTION, VERBOSE_OPTION, LIST_OPTION, DEVICE_OPTION,
-		STATUS_OPTION, MONITOR_OPTION, RESET_OPTION, SYNC_OPTION,
-		SAVE_OPTION, LOAD_OPTION, DUMP_OPTION,
-		AXES_OPTION, INVERT_OPTION, ZOOM_OPTION, AUTODISCOVERY_OPTION, SHUTOFF_OPTION,
-		BUTTONS_OPTION, ENCODER_OPTION, PULSEWIDTH_OPTION,
-	};
-
-	const struct command_line_option options[] = {
-		{ "--help",           "-h", 0, "\0" },
-		{ "--version",           0, 0, "\0" },
-		{ "--verbose",        "-v", 0, "\0" },
-		{ "--list",           "-l", 0, "\0" },
-		{ "--device",         "-d", 1, "\0" },
-		//
-		{ "--status",         "-s", 0, "d"  },
-		{ "--monitor",        "-m", 0, "d"  },
-		{ "--reset",          "-r", 0, "d"  },
-		{ "--sync",           "-y", 0, "d"  },
-		{ "--save",           "-O", 1, "d"  },
-		{ "--load",           "-I", 1, "d"  },
-		{ "--dump",           "-X", 0, "d"  },
-		//
-		{ "--axes",           "-a", 1, "\0" },
-		{ "--invert",         "-i", 1, "a"  },
-		{ "--zoom",           "-z", 1, "a"  },
-		{ "--autodiscovery",  "-u", 1, "d"  },
-		{ "--shut-off",       "-f", 1, "a"  },
-		//
-		{ "--buttons",        "-b", 1, "\0" },
-		{ "--encoder",        "-e", 1, "b"  },
-		{ "--pulse-width",    "-p", 1, "b"  },
-		OPTIONS_LAST
-	};
-
-	// option extensions:
-	// "d" ... requires device
-	// "a" ... requires axis support & selection
-	// "b" ... requires encoder support & button selection
 
-	int option;
-	struct option_parser_context ctx;
 
-	// first pass options
-	set_log_level(WARN);
-	init_options_context(&ctx, argc, argv, options);
-	while ((option = get_option(&ctx)) != OPTIONS_DONE) {
-		if (option == HELP_OPTION) {
-			help();
-			return EXIT_SUCCESS;
+const char *boolmsg = "bool (one of {1|on|true|yes} or {0|off|false|no})";
 
-		} else if (option == VERSION_OPTION) {
-			version();
-			return EXIT_SUCCESS;
+// state carried from one option (or batch command) to the next
+struct session {
+	session() : selected_axes(0), selected_buttons(0), batch(false) {}
+	uint32_t selected_axes;
+	uint32_t selected_buttons;
+	bool batch;                              // defer --sync to the end of the batch
+	set<bu0836::controller *> sync;          // devices to write at the end of the batch
+};
 
-		} else if (option == VERBOSE_OPTION) {
-			set_log_level(get_log_level() - 1);
-		}
+
+
+void execute(bu0836::manager &dev, session &s, int option, const char *argument)
+{
+	TIMING_PHASE(options[option].long_opt);
+
+	// check for basic option requirements
+	char req = options[option].ext[0];
+	if (req) {
+		if (dev.empty())
+			throw string("no BU0836 device found");
+		if (!dev.selected())
+			throw string("you need to select a device before you can use the ")
+					+ options[option].long_opt + " option, for\n       example with -d"
+					+ dev[0].bus_address() + " or -d" + dev[0].serial()
+					+ ". Use the --list option for available devices.";
+		if (dev.selected()->claim())
+			throw string("cannot access device '") + dev[0].serial() + '\'';
+
+		const char *ext = options[option].ext + 1;
+		if ((strchr(ext, 'l') && dev.selected()->require_layout())
+				|| (strchr(ext, 'c') && dev.selected()->require_eeprom(bu0836::EEPROM_CONFIG_FIRST,
+				bu0836::EEPROM_CONFIG_LAST))
+				|| (strchr(ext, 'e') && dev.selected()->require_eeprom(bu0836::EEPROM_FIRST,
+				bu0836::EEPROM_LAST)))
+			throw string("cannot read from device '") + dev.selected()->serial() + '\'';
 	}
 
-	bu0836::manager dev;
-	uint32_t selected_axes = 0;
-	uint32_t selected_buttons = 0;
-	const char *boolmsg = "bool (one of {1|on|true|yes} or {0|off|false|no})";
+	if (req == 'a' && !s.selected_axes)
+		throw string("no axes selected for ") + options[option].long_opt + " option";
+	if (req == 'b' && !s.selected_buttons)
+		throw string("no buttons selected for ") + options[option].long_opt + " option";
+
+	switch (option) {
+	case LIST_OPTION:
+		list_devices(dev);
+		break;
+
+	case DEVICE_OPTION: {
+		int num = dev.select(argument);
+		if (num == 1)
+			log(INFO) << "selecting device '" << dev.selected()->serial() << '\'' << endl;
+		else if (num)
+			throw string("ambiguous device specifier (") + num + " matching devices found)";
+		else
+			throw string("no matching device found");
+		break;
+	}
 
-	// second pass options
-	init_options_context(&ctx, argc, argv, options);
-	while ((option = get_option(&ctx)) != OPTIONS_DONE) {
+	case STATUS_OPTION:
+		print_status(dev.selected());
+		break;
+
+	case MONITOR_OPTION:
+		dev.selected()->show_input_reports();
+		break;
 
-		// check for basic option requirements
-		if (option >= 0) {
-			char req = options[option].ext[0];
-			if (req) {
-				if (dev.empty())
-					throw string("no BU0836 device found");
-				if (!dev.selected())
-					throw string("you need to select a device before you can use the ")
-							+ options[option].long_opt + " option, for\n       example with -d"
-							+ dev[0].bus_address() + " or -d" + dev[0].serial()
-							+ ". Use the --list option for available devices.";
-				if (dev.selected()->claim())
-					throw string("cannot access device '") + dev[0].serial() + '\'';
+	case RESET_OPTION:
+		log(INFO) << "resetting configuration to \"factory default\"" << endl;
+		dev.selected()->set_autodiscovery(true);
+
+		if (dev.selected()->capabilities() & bu0836::INVERT) {
+			for (int i = 0; i < NUM_AXES; i++) {
+				dev.selected()->set_invert(i, false);
+				dev.selected()->set_shutoff(i, false);
 			}
+		}
+
+		if (dev.selected()->capabilities() & bu0836::ZOOM)
+			for (int i = 0; i < NUM_AXES; i++)
+				dev.selected()->set_zoom(i, 0);
 
-			if (req == 'a' && !selected_axes)
-				throw string("no axes selected for ") + options[option].long_opt + " option";
-			if (req == 'b' && !selected_buttons)
-				throw string("no buttons selected for ") + options[option].long_opt + " option";
+		if (dev.selected()->capabilities() & bu0836::ENCODER1) {
+			dev.selected()->set_pulse_width(6);
+			for (int i = 0; i < NUM_BUTTONS; i += 2)
+				dev.selected()->set_encoder_mode(i, 0);
 		}
+		break;
 
-		switch (option) {
-		case LIST_OPTION:
-			list_devices(dev);
+	case SYNC_OPTION:
+		if (s.batch) {
+			log(INFO) << "write changes to EEPROM at end of batch" << endl;
+			s.sync.insert(dev.selected());
 			break;
-
-		case DEVICE_OPTION: {
-			int num = dev.select(ctx.argument);
-			if (num == 1)
-				log(INFO) << "selecting device '" << dev.selected()->serial() << '\'' << endl;
-			else if (num)
-				throw string("ambiguous device specifier (") + num + " matching devices found)";
-			else
-				throw string("no matching device found");
+		}
+		log(INFO) << "write changes to EEPROM" << endl;
+		dev.selected()->sync();
+		break;
+
+	case SAVE_OPTION:
+		log(INFO) << "saving image to file '" << argument << '\'' << endl;
+		if (!dev.selected()->get_eeprom(bu0836::EEPROM_FIRST, bu0836::EEPROM_LAST)
+				&& !dev.selected()->save_image_file(argument))
+			log(INFO) << "saved" << endl;
+		break;
+
+	case LOAD_OPTION:
+		log(INFO) << "loading image from file '" << argument << '\'' << endl;
+		if (dev.selected()->load_image_file(argument))
+			break;
+		if (s.batch) {
+			log(INFO) << "write image to EEPROM at end of batch" << endl;
+			s.sync.insert(dev.selected());
 			break;
 		}
+		if (!dev.selected()->sync())
+			log(INFO) << "loaded" << endl;
+		break;
+
+	case DUMP_OPTION:
+		cout << dev.selected()->jsid() << endl << magenta << "-- " << hex << setfill('0');
+		for (int i = 0; i < 16; i++)
+			cout << setw(2) << i << ' ';
+		cout << reset << endl;
+		for (int i = 0; i < 16; i++)
+			cout << magenta << setw(2) << i * 16 << ' ' << reset
+					<< bytes(dev.selected()->eeprom() + i * 16, 16) << endl;
+		cout << dec << endl;
+		break;
+
+	case EMIT_DECODER_OPTION:
+		log(INFO) << "writing decoder to file '" << argument << '\'' << endl;
+		if (!dev.selected()->emit_decoder(argument))
+			log(INFO) << "written" << endl;
+		else
+			throw string("cannot generate decoder for device '") + dev.selected()->serial() + '\'';
+		break;
+
+	case AXES_OPTION:
+		s.selected_axes = numlist_to_bitmap(argument, 7);
+		log(INFO) << "selecting axes 0x" << hex << s.selected_axes << dec << endl;
+		break;
+
+	case INVERT_OPTION: {
+		require(dev, bu0836::INVERT, "axis configuration");
+		bool b = boolify(argument, string("--invert expects a ") + boolmsg);
+		log(INFO) << "setting axes to inverted=" << argument << endl;
+		for (int i = 0; i < NUM_AXES; i++)
+			if (s.selected_axes & (1 << i))
+				dev.selected()->set_invert(i, b);
+		break;
+	}
 
-		case STATUS_OPTION:
-			print_status(dev.selected());
-			break;
+	case ZOOM_OPTION: {
+		require(dev, bu0836::ZOOM, "--zoom option (BU0836 or v < 1.18)");
+		istringstream x(argument);
+		int zoom;
+		x >> zoom;
+		try {
+			if (x.fail())
+				zoom = boolify(argument) ? 198 : 0;
+			else if (!x.eof() || zoom < 0 || zoom > 255)
+				throw zoom;
+		} catch (...) {
+			throw string("invalid argument to --zoom: use \"on\"/198, \"off\"/0, "
+					"or number in range 0-255");
+		}
+		log(INFO) << "setting axes to zoom=" << zoom << endl;
+		for (int i = 0; i < NUM_AXES; i++)
+			if (s.selected_axes & (1 << i))
+				dev.selected()->set_zoom(i, zoom);
+		break;
+	}
 
-		case MONITOR_OPTION:
-			dev.selected()->show_input_reports();
-			break;
+	case AUTODISCOVERY_OPTION: {
+		bool b = boolify(argument, string("--autodiscovery expects a ") + boolmsg);
+		log(INFO) << "setting autodiscovery to " << b << endl;
+		dev.selected()->set_autodiscovery(b);
+		break;
+	}
 
-		case RESET_OPTION:
-			log(INFO) << "resetting configuration to \"factory default\"" << endl;
-			dev.selected()->set_autodiscovery(true);
+	case SHUTOFF_OPTION: {
+		bool b = boolify(argument, string("--shut-off expects a ") + boolmsg);
+		log(INFO) << "setting axes to shutoff=" << b << endl;
+		for (int i = 0; i < NUM_AXES; i++)
+			if (s.selected_axes & (1 << i))
+				dev.selected()->set_shutoff(i, b);
+		break;
+	}
 
-			if (dev.selected()->capabilities() & bu0836::INVERT) {
-				for (int i = 0; i < NUM_AXES; i++) {
-					dev.selected()->set_invert(i, false);
-					dev.selected()->set_shutoff(i, false);
-				}
-			}
+	case BUTTONS_OPTION:
+		s.selected_buttons = numlist_to_bitmap(argument, 31);
+		log(INFO) << "selecting buttons 0x" << hex << s.selected_buttons << dec << endl;
+		break;
+
+	case ENCODER_OPTION: {
+		require(dev, bu0836::ENCODER1, "encoder configuration");
+		string arg = argument;
+		int enc;
+		if (arg == "off" || arg == "0")
+			enc = 0;
+		else if (arg == "1:1" || arg == "1")
+			enc = 1;
+		else if (arg == "1:2" || arg == "2")
+			enc = 2;
+		else if (arg == "1:4" || arg == "3")
+			enc = 3;
+		else
+			throw string("invalid argument to --encoder: use \"off\"/0, \"1:1\"/1")
+					+ (dev.selected()->capabilities() & bu0836::ENCODER2
+					? ", \"1:2\"/2, or \"1:4\"/3" : "");
+
+		if (enc == 1)
+			require(dev, bu0836::ENCODER1, "--encoder=1:1 (v < 1.20)");
+		if (enc > 1)
+			require(dev, bu0836::ENCODER2, "--encoder=1:2 and 1:4 (v < 1.21)");
+
+		log(INFO) << "configuring buttons for encoder mode " << enc << endl;
+		for (int i = 0; i < 31; i++)
+			if (s.selected_buttons & (1 << i))
+				dev.selected()->set_encoder_mode(i, enc);
+		break;
+	}
 
-			if (dev.selected()->capabilities() & bu0836::ZOOM)
-				for (int i = 0; i < NUM_AXES; i++)
-					dev.selected()->set_zoom(i, 0);
+	case PULSEWIDTH_OPTION: {
+		require(dev, bu0836::ENCODER1, "encoder/pulse width configuration");
+		istringstream x(argument);
+		unsigned int p;
+		x >> p;
+		if (!x.eof()) {
+			string ms;
+			x >> ms;
+			if (ms != "ms")
+				throw string("invalid argument to --pulse-width: must be integer in the range "
+						"1-11, or in the range 8-88 and followed by \"ms\", e.g. 48ms");
+			if (p < 8)
+				p = 8;
+			else if (p > 88)
+				p = 88;
+			p = (p + 4) / 8;
+		} else if (p < 1 || p > 11) {
+			throw string("requested pulse width out of range (1-11)");
+		}
 
-			if (dev.selected()->capabilities() & bu0836::ENCODER1) {
-				dev.selected()->set_pulse_width(6);
-				for (int i = 0; i < NUM_BUTTONS; i += 2)
-					dev.selected()->set_encoder_mode(i, 0);
-			}
-			break;
+		log(INFO) << "pulse width = " << p << "  (" << p * 8 << " ms)" << endl;
+		dev.selected()->set_pulse_width(p);
+		break;
+	}
+	// ignored options
+	case HELP_OPTION:
+	case VERSION_OPTION:
+	case VERBOSE_OPTION:
+	case TRACE_OPTION:
+	case TIMING_OPTION:
+	case METRICS_OPTION:
+	case SIMULATE_OPTION:
+	case NO_DAEMON_OPTION:
+		break;
+
+	default:
+		throw string("this can't happen (") + option + '/' + options[option].long_opt + ')';
+	}
+}
 
-		case SYNC_OPTION:
-			log(INFO) << "write changes to EEPROM" << endl;
-			dev.selected()->sync();
-			break;
 
-		case SAVE_OPTION:
-			log(INFO) << "saving image to file '" << ctx.argument << '\'' << endl;
-			if (!dev.selected()->get_eeprom() && !dev.selected()->save_image_file(ctx.argument))
-				log(INFO) << "saved" << endl;
-			break;
 
-		case LOAD_OPTION:
-			log(INFO) << "loading image from file '" << ctx.argument << '\'' << endl;
-			if (!dev.selected()->load_image_file(ctx.argument) && !dev.selected()->set_eeprom(0x00, 0xff))
-				log(INFO) << "loaded" << endl;
-			break;
+// Batch commands and the options they stand for. "set" takes NAME=VALUE
+// pairs, where NAME is the long name of an axis or encoder option.
+const struct {
+	const char *name;
+	int option;
+} batch_commands[] = {
+	{ "list",   LIST_OPTION },
+	{ "select", DEVICE_OPTION },
+	{ "status", STATUS_OPTION },
+	{ "reset",  RESET_OPTION },
+	{ "sync",   SYNC_OPTION },
+	{ "save",   SAVE_OPTION },
+	{ "load",   LOAD_OPTION },
+	{ "dump",   DUMP_OPTION },
+};
 
-		case DUMP_OPTION:
-			cout << dev.selected()->jsid() << endl << magenta << "-- " << hex << setfill('0');
-			for (int i = 0; i < 16; i++)
-				cout << setw(2) << i << ' ';
-			cout << reset << endl;
-			for (int i = 0; i < 16; i++)
-				cout << magenta << setw(2) << i * 16 << ' ' << reset
-						<< bytes(dev.selected()->eeprom() + i * 16, 16) << endl;
-			cout << dec << endl;
-			break;
 
-		case AXES_OPTION:
-			selected_axes = numlist_to_bitmap(ctx.argument, 7);
-			log(INFO) << "selecting axes 0x" << hex << selected_axes << dec << endl;
-			break;
 
-		case INVERT_OPTION: {
-			require(dev, bu0836::INVERT, "axis configuration");
-			bool b = boolify(ctx.argument, string("--invert expects a ") + boolmsg);
-			log(INFO) << "setting axes to inverted=" << ctx.argument << endl;
-			for (int i = 0; i < NUM_AXES; i++)
-				if (selected_axes & (1 << i))
-					dev.selected()->set_invert(i, b);
-			break;
-		}
+void run_batch_command(bu0836::manager &dev, session &s, const string &line)
+{
+	istringstream words(line.substr(0, line.find('#')));
+	string cmd, arg;
+	if (!(words >> cmd))
+		return;
+
+	if (cmd == "set") {
+		if (!(words >> arg))
+			throw string("set expects NAME=VALUE");
+		do {
+			size_t eq = arg.find('=');
+			int option = AXES_OPTION;
+			if (eq != string::npos)
+				for (; option <= PULSEWIDTH_OPTION; option++)
+					if (options[option].long_opt + 2 == arg.substr(0, eq))
+						break;
+			if (eq == string::npos || option > PULSEWIDTH_OPTION)
+				throw string("set expects NAME=VALUE with NAME one of axes, invert, zoom, "
+						"autodiscovery, shut-off, buttons, encoder, pulse-width, not '") + arg + '\'';
+			execute(dev, s, option, arg.c_str() + eq + 1);
+		} while (words >> arg);
+		return;
+	}
 
-		case ZOOM_OPTION: {
-			require(dev, bu0836::ZOOM, "--zoom option (BU0836 or v < 1.18)");
-			istringstream x(ctx.argument);
-			int zoom;
-			x >> zoom;
-			try {
-				if (x.fail())
-					zoom = boolify(ctx.argument) ? 198 : 0;
-				else if (!x.eof() || zoom < 0 || zoom > 255)
-					throw zoom;
-			} catch (...) {
-				throw string("invalid argument to --zoom: use \"on\"/198, \"off\"/0, "
-						"or number in range 0-255");
-			}
-			log(INFO) << "setting axes to zoom=" << zoom << endl;
-			for (int i = 0; i < NUM_AXES; i++)
-				if (selected_axes & (1 << i))
-					dev.selected()->set_zoom(i, zoom);
-			break;
+	size_t i = 0;
+	while (i < sizeof(batch_commands) / sizeof(*batch_commands) && cmd != batch_commands[i].name)
+		i++;
+	if (i == sizeof(batch_commands) / sizeof(*batch_commands))
+		throw string("unknown command '") + cmd + '\'';
+
+	int option = batch_commands[i].option;
+	if (options[option].has_arg && !(words >> arg))
+		throw cmd + " expects an argument";
+	words >> ws;
+	if (!words.eof())
+		throw string("too many arguments to ") + cmd;
+	execute(dev, s, option, arg.c_str());
+}
+
+
+
+// Runs commands from file ("-" for stdin) on the devices enumerated at
+// startup. Writes are collected and done once per device at the end, so
+// nothing is written if any command fails, or if a device has changes
+// without a sync command (batch mode never asks).
+void run_batch(bu0836::manager &dev, session &s, const char *file)
+{
+	ifstream f;
+	bool from_stdin = !strcmp(file, "-");
+	if (!from_stdin) {
+		f.open(file);
+		if (!f)
+			throw string("cannot open batch file '") + file + '\'';
+	}
+	istream &in = from_stdin ? cin : f;
+
+	s.batch = true;
+	string line;
+	for (int num = 1; getline(in, line); num++) {
+		try {
+			run_batch_command(dev, s, line);
+		} catch (const string &msg) {
+			throw string(from_stdin ? "stdin" : file) + ':' + num + ": " + msg;
 		}
+	}
+	s.batch = false;
 
-		case AUTODISCOVERY_OPTION: {
-			bool b = boolify(ctx.argument, string("--autodiscovery expects a ") + boolmsg);
-			log(INFO) << "setting autodiscovery to " << b << endl;
-			dev.selected()->set_autodiscovery(b);
-			break;
+	int unsynced = 0;
+	for (size_t i = 0; i < dev.size(); i++) {
+		if (dev[i].is_dirty() && !s.sync.count(&dev[i])) {
+			log(ALERT) << "unsynced changes on device '" << dev[i].serial() << "' (add a sync command)"
+					<< endl;
+			unsynced++;
 		}
+	}
+	if (unsynced)
+		throw string("batch incomplete: ") + unsynced + " device(s) with unsynced changes, nothing written";
 
-		case SHUTOFF_OPTION: {
-			bool b = boolify(ctx.argument, string("--shut-off expects a ") + boolmsg);
-			log(INFO) << "setting axes to shutoff=" << b << endl;
-			for (int i = 0; i < NUM_AXES; i++)
-				if (selected_axes & (1 << i))
-					dev.selected()->set_shutoff(i, b);
-			break;
+	TIMING_PHASE("batch writes");
+	int failed = 0;
+	for (size_t i = 0; i < dev.size(); i++) {
+		if (!s.sync.count(&dev[i]) || !dev[i].is_dirty())
+			continue;
+		log(INFO) << "writing changes to EEPROM of device '" << dev[i].serial() << '\'' << endl;
+		if (dev[i].sync()) {
+			log(ALERT) << "cannot write EEPROM of device '" << dev[i].serial() << '\'' << endl;
+			failed++;
 		}
+	}
+	s.sync.clear();
+	if (failed)
+		throw string("batch incomplete: ") + failed + " device(s) not written";
+}
+
+} // namespace
 
-		case BUTTONS_OPTION:
-			selected_buttons = numlist_to_bitmap(ctx.argument, 31);
-			log(INFO) << "selecting buttons 0x" << hex << selected_buttons << dec << endl;
-			break;
 
-		case ENCODER_OPTION: {
-			require(dev, bu0836::ENCODER1, "encoder configuration");
-			string arg = ctx.argument;
-			int enc;
-			if (arg == "off" || arg == "0")
-				enc = 0;
-			else if (arg == "1:1" || arg == "1")
-				enc = 1;
-			else if (arg == "1:2" || arg == "2")
-				enc = 2;
-			else if (arg == "1:4" || arg == "3")
-				enc = 3;
-			else
-				throw string("invalid argument to --encoder: use \"off\"/0, \"1:1\"/1")
-						+ (dev.selected()->capabilities() & bu0836::ENCODER2
-						? ", \"1:2\"/2, or \"1:4\"/3" : "");
-
-			if (enc == 1)
-				require(dev, bu0836::ENCODER1, "--encoder=1:1 (v < 1.20)");
-			if (enc > 1)
-				require(dev, bu0836::ENCODER2, "--encoder=1:2 and 1:4 (v < 1.21)");
-
-			log(INFO) << "configuring buttons for encoder mode " << enc << endl;
-			for (int i = 0; i < 31; i++)
-				if (selected_buttons & (1 << i))
-					dev.selected()->set_encoder_mode(i, enc);
-			break;
-		}
 
-		case PULSEWIDTH_OPTION: {
-			require(dev, bu0836::ENCODER1, "encoder/pulse width configuration");
-			istringstream x(ctx.argument);
-			unsigned int p;
-			x >> p;
-			if (!x.eof()) {
-				string ms;
-				x >> ms;
-				if (ms != "ms")
-					throw string("invalid argument to --pulse-width: must be integer in the range "
-							"1-11, or in the range 8-88 and followed by \"ms\", e.g. 48ms");
-				if (p < 8)
-					p = 8;
-				else if (p > 88)
-					p = 88;
-				p = (p + 4) / 8;
-			} else if (p < 1 || p > 11) {
-				throw string("requested pulse width out of range (1-11)");
+int main(int argc, const char *argv[]) try
+{
+	int option;
+	struct option_parser_context ctx;
+	bu0836::transport *transport = 0;
+	bool use_daemon = true;
+
+	// first pass options
+	set_log_level(WARN);
+	init_options_context(&ctx, argc, argv, options);
+	while ((option = get_option(&ctx)) != OPTIONS_DONE) {
+		if (option == HELP_OPTION) {
+			help();
+			return EXIT_SUCCESS;
+
+		} else if (option == VERSION_OPTION) {
+			version();
+			return EXIT_SUCCESS;
+
+		} else if (option == VERBOSE_OPTION) {
+			set_log_level(get_log_level() - 1);
+
+		} else if (option == TRACE_OPTION) {
+			trace::start(ctx.argument);
+
+		} else if (option == TIMING_OPTION) {
+			trace::start_timing();
+
+		} else if (option == METRICS_OPTION) {
+			metrics::start(ctx.argument);
+
+		} else if (option == SIMULATE_OPTION || (option == OPTIONS_EXCESS_ARGUMENT
+				&& ctx.option == options[SIMULATE_OPTION].long_opt)) {
+			bu0836::simulator::config cfg;
+			if (option == OPTIONS_EXCESS_ARGUMENT) {
+				char *end;
+				cfg.boards = strtol(ctx.argument, &end, 10);
+				if (*end || cfg.boards < 1 || cfg.boards > 127)
+					throw string("--simulate: number of devices must be from 1-127");
 			}
+			delete transport;
+			transport = new bu0836::simulator(cfg);
 
-			log(INFO) << "pulse width = " << p << "  (" << p * 8 << " ms)" << endl;
-			dev.selected()->set_pulse_width(p);
-			break;
+		} else if (option == NO_DAEMON_OPTION) {
+			use_daemon = false;
 		}
+	}
+
+	if (!transport && use_daemon)
+		transport = bu0836::remote_transport::connect();
+
+	bu0836::manager dev(transport);
+	session s;
 
-		// ignored options
-		case HELP_OPTION:
-		case VERSION_OPTION:
-		case VERBOSE_OPTION:
+	// second pass options
+	init_options_context(&ctx, argc, argv, options);
+	while ((option = get_option(&ctx)) != OPTIONS_DONE) {
+		switch (option) {
+		case BATCH_OPTION:
+			run_batch(dev, s, "-");
+			break;
 
 		// signals and errors
 		case OPTIONS_TERMINATOR:
@@ -594,6 +844,12 @@ int main(int argc, const char *argv[]) try
 			throw string("don't know what to do with an argument '") + ctx.option + '\'';
 
 		case OPTIONS_EXCESS_ARGUMENT:
+			if (ctx.option == options[SIMULATE_OPTION].long_opt)
+				break;
+			if (ctx.option == options[BATCH_OPTION].long_opt) {
+				run_batch(dev, s, ctx.argument);
+				break;
+			}
 			throw string("illegal option assignment '") + ctx.argument + '\'';
 
 		case OPTIONS_UNKNOWN_OPTION:
@@ -603,7 +859,7 @@ int main(int argc, const char *argv[]) try
 			throw string("missing argument for option '") + ctx.option + '\'';
 
 		default:
-			throw string("this can't happen (") + option + '/' + ctx.option + ')';
+			execute(dev, s, option, ctx.argument);
 		}
 	}
 
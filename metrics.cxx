@@ -0,0 +1,227 @@
+// controller metrics
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#include <cstdio>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <sys/time.h>
+#include <time.h>
+#include <vector>
+
+#include "logging.hxx"
+#include "metrics.hxx"
+
+using namespace std;
+using namespace logging;
+
+
+
+namespace metrics {
+
+namespace {
+
+const char *error_names[counters::NUM_ERRORS] = {
+	"LIBUSB_ERROR_OTHER", "LIBUSB_ERROR_IO", "LIBUSB_ERROR_INVALID_PARAM", "LIBUSB_ERROR_ACCESS",
+	"LIBUSB_ERROR_NO_DEVICE", "LIBUSB_ERROR_NOT_FOUND", "LIBUSB_ERROR_BUSY", "LIBUSB_ERROR_TIMEOUT",
+	"LIBUSB_ERROR_OVERFLOW", "LIBUSB_ERROR_PIPE", "LIBUSB_ERROR_INTERRUPTED", "LIBUSB_ERROR_NO_MEM",
+	"LIBUSB_ERROR_NOT_SUPPORTED",
+};
+
+struct entry {
+	const counters *c;
+	string labels;                // {bus="...",serial="..."}
+	unsigned long last_reports;   // for the report rate
+	double last_time;
+};
+
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER; // protects everything below
+pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+vector<entry> entries;
+string output;
+int interval = 0;
+bool running = false;
+pthread_t writer;
+
+
+
+double now()
+{
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+
+string label_value(const string &s)
+{
+	string r;
+	for (string::size_type i = 0; i < s.size(); i++) {
+		if (s[i] == '\\' || s[i] == '"')
+			r += '\\';
+		if (s[i] == '\n')
+			r += "\\n";
+		else
+			r += s[i];
+	}
+	return r;
+}
+
+
+
+unsigned long get(const unsigned long &c)
+{
+	return __atomic_load_n(&c, __ATOMIC_RELAXED);
+}
+
+
+
+void write_family(FILE *f, const char *name, const char *type, const char *help,
+		unsigned long counters::*member)
+{
+	fprintf(f, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+	for (size_t i = 0; i < entries.size(); i++)
+		fprintf(f, "%s%s %lu\n", name, entries[i].labels.c_str(), get(entries[i].c->*member));
+}
+
+
+
+// called with the mutex locked
+void write_metrics()
+{
+	string tmp = output + ".tmp";
+	FILE *f = fopen(tmp.c_str(), "w");
+	if (!f) {
+		log(ALERT) << "metrics: cannot write to '" << tmp << "'" << endl;
+		return;
+	}
+
+	write_family(f, "bu0836_reports_total", "counter", "Input reports received.", &counters::reports);
+	write_family(f, "bu0836_decode_errors_total", "counter", "Input reports too short for the HID layout.",
+			&counters::decode_errors);
+	write_family(f, "bu0836_timeouts_total", "counter", "Input report transfers that timed out.",
+			&counters::timeouts);
+	write_family(f, "bu0836_reconnects_total", "counter",
+			"Times the report stream resumed after a transfer error.", &counters::reconnects);
+
+	fprintf(f, "# HELP bu0836_usb_errors_total libusb errors by code.\n");
+	fprintf(f, "# TYPE bu0836_usb_errors_total counter\n");
+	for (size_t i = 0; i < entries.size(); i++) {
+		const string &l = entries[i].labels;
+		for (int k = 0; k < counters::NUM_ERRORS; k++) {
+			unsigned long n = get(entries[i].c->errors[k]);
+			if (n)
+				fprintf(f, "bu0836_usb_errors_total%.*s,error=\"%s\"} %lu\n", int(l.size() - 1), l.c_str(),
+						error_names[k], n);
+		}
+	}
+
+	fprintf(f, "# HELP bu0836_report_rate Input reports per second since the last update.\n");
+	fprintf(f, "# TYPE bu0836_report_rate gauge\n");
+	double t = now();
+	for (size_t i = 0; i < entries.size(); i++) {
+		entry &e = entries[i];
+		unsigned long n = get(e.c->reports);
+		double rate = t > e.last_time ? (n - e.last_reports) / (t - e.last_time) : 0.0;
+		fprintf(f, "bu0836_report_rate%s %.1f\n", e.labels.c_str(), rate);
+		e.last_reports = n;
+		e.last_time = t;
+	}
+
+	if (fclose(f) || rename(tmp.c_str(), output.c_str()))
+		log(ALERT) << "metrics: error writing '" << output << "'" << endl;
+}
+
+
+
+void *write_loop(void *)
+{
+	pthread_mutex_lock(&mutex);
+	while (running) {
+		timespec deadline = {time(0) + interval, 0};
+		if (pthread_cond_timedwait(&wakeup, &mutex, &deadline) && running)
+			write_metrics();
+	}
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+
+struct shutdown {
+	~shutdown() {
+		pthread_mutex_lock(&mutex);
+		bool was_running = running;
+		running = false;
+		pthread_cond_signal(&wakeup);
+		pthread_mutex_unlock(&mutex);
+		if (was_running)
+			pthread_join(writer, 0);
+	}
+} shutdown_on_exit;
+
+} // namespace
+
+
+
+void add(const counters *c, const string &bus_address, const string &serial)
+{
+	entry e;
+	e.c = c;
+	e.labels = "{bus=\"" + label_value(bus_address) + "\",serial=\"" + label_value(serial) + "\"}";
+	e.last_reports = get(c->reports);
+	e.last_time = now();
+
+	pthread_mutex_lock(&mutex);
+	entries.push_back(e);
+	pthread_mutex_unlock(&mutex);
+}
+
+
+
+void remove(const counters *c)
+{
+	pthread_mutex_lock(&mutex);
+	for (vector<entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+		if (it->c == c) {
+			entries.erase(it);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+
+
+void start(const char *path, int seconds)
+{
+	pthread_mutex_lock(&mutex);
+	if (!running) {
+		output = path;
+		interval = seconds;
+		running = true;
+		if (pthread_create(&writer, 0, write_loop, 0)) {
+			log(ALERT) << "metrics: cannot start writer thread" << endl;
+			running = false;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+} // namespace metrics
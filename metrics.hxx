@@ -0,0 +1,66 @@
+// controller metrics
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#ifndef _METRICS_HXX_
+#define _METRICS_HXX_
+
+#include <string>
+
+
+
+namespace metrics {
+
+// Counters of one controller. Each counter has only one writer (the thread
+// that uses the controller), so an update is a relaxed load and store without
+// a locked instruction. The metrics writer thread only reads them.
+struct counters {
+	enum { NUM_ERRORS = 13 }; // LIBUSB_ERROR_IO (-1) .. LIBUSB_ERROR_NOT_SUPPORTED (-12) at
+	                          // index -code, everything else at index 0
+	counters() : reports(0), decode_errors(0), timeouts(0), reconnects(0) {
+		for (int i = 0; i < NUM_ERRORS; i++)
+			errors[i] = 0;
+	}
+
+	static void count(unsigned long &c) {
+		__atomic_store_n(&c, __atomic_load_n(&c, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+	}
+
+	void error(int code) { count(errors[code < 0 && -code < NUM_ERRORS ? -code : 0]); }
+
+	unsigned long reports;       // input reports received
+	unsigned long decode_errors; // reports too short for the HID layout
+	unsigned long timeouts;      // input report transfers that timed out
+	unsigned long reconnects;    // report stream resumed after a transfer error
+	unsigned long errors[NUM_ERRORS];
+};
+
+
+
+// Controllers register their counters under their bus address and serial
+// number, and have to remove them before they are destroyed.
+void add(const counters *c, const std::string &bus_address, const std::string &serial);
+void remove(const counters *c);
+
+// Rewrites path every interval seconds with the metrics of all registered
+// controllers in Prometheus text format (for node_exporter's textfile
+// collector and the like). The file is replaced atomically.
+void start(const char *path, int interval = 5);
+
+} // namespace metrics
+
+#endif
@@ -0,0 +1,487 @@
+// bu0836d protocol and client transport
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "logging.hxx"
+#include "remote.hxx"
+
+using namespace std;
+using namespace logging;
+
+
+
+namespace bu0836 {
+
+namespace {
+
+const size_t MAX_QUEUED_REPORTS = 64; // per device; older ones are dropped
+
+
+
+double now_ms()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+} // namespace
+
+
+
+string protocol::socket_path()
+{
+	const char *s = getenv("BU0836_SOCKET");
+	if (s && *s)
+		return s;
+	s = getenv("XDG_RUNTIME_DIR");
+	if (s && *s)
+		return string(s) + "/bu0836.sock";
+	ostringstream path;
+	path << "/tmp/bu0836-" << getuid() << ".sock";
+	return path.str();
+}
+
+
+
+bool protocol::same_user(int fd)
+{
+	ucred cred;
+	socklen_t len = sizeof(cred);
+	return !getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) && cred.uid == geteuid();
+}
+
+
+
+class remote_device : public usb_device {
+public:
+	remote_device(remote_transport &t, uint8_t index) :
+		_transport(t), _index(index), _eeprom_valid(false), _page(0), _subscribed(false) {}
+
+	~remote_device() {
+		if (_subscribed)
+			_transport.send(protocol::UNSUBSCRIBE, _index, 0, 0);
+	}
+
+	int bus_number() { return bus; }
+	int address() { return addr; }
+
+	int get_device_descriptor(libusb_device_descriptor *d) {
+		*d = desc;
+		return 0;
+	}
+
+	int get_string_descriptor_ascii(uint8_t index, unsigned char *buf, int length) {
+		if (index < 1 || index > 3)
+			return LIBUSB_ERROR_INVALID_PARAM;
+		const string &s = strings[index - 1];
+		int n = int(s.size()) < length ? s.size() : length;
+		memcpy(buf, s.data(), n);
+		return n;
+	}
+
+	int get_descriptor(uint8_t type, uint8_t, unsigned char *buf, int length) {
+		if (type == LIBUSB_DT_HID) {
+			size_t len = report_descriptor.size();
+			const unsigned char hid[] = { 9, LIBUSB_DT_HID, 0x10, 0x01, 0, 1, LIBUSB_DT_REPORT,
+					(unsigned char)(len & 0xff), (unsigned char)(len >> 8) };
+			int n = length < int(sizeof(hid)) ? length : sizeof(hid);
+			memcpy(buf, hid, n);
+			return n;
+		}
+		if (type == LIBUSB_DT_REPORT) {
+			int n = length < int(report_descriptor.size()) ? length : report_descriptor.size();
+			if (n)
+				memcpy(buf, &report_descriptor[0], n);
+			return n;
+		}
+		return LIBUSB_ERROR_PIPE;
+	}
+
+	// the daemon has the interface
+	int kernel_driver_active(int) { return 0; }
+	int detach_kernel_driver(int) { return LIBUSB_ERROR_NOT_SUPPORTED; }
+	int attach_kernel_driver(int) { return LIBUSB_ERROR_NOT_SUPPORTED; }
+	int claim_interface(int) { return 0; }
+	int release_interface(int) { return 0; }
+
+	// Only FEATURE GET_REPORT, which delivers the pages of the daemon's
+	// EEPROM image in order. Writes are asynchronous (remote_transfer).
+	int control_transfer(uint8_t request_type, uint8_t request, uint16_t value, uint16_t,
+			unsigned char *data, uint16_t length, unsigned int) {
+		if (request_type != 0xa1 || request != 0x01 || value != 0x0300)
+			return LIBUSB_ERROR_NOT_SUPPORTED;
+		if (length < 17)
+			return LIBUSB_ERROR_OVERFLOW;
+		if (!_eeprom_valid) {
+			vector<unsigned char> image;
+			int ret = _transport.request(protocol::READ, _index, 0, 0, &image);
+			if (ret < 0)
+				return ret;
+			if (image.size() != sizeof(_eeprom))
+				return LIBUSB_ERROR_IO;
+			memcpy(_eeprom, &image[0], sizeof(_eeprom));
+			_eeprom_valid = true;
+			_page = 0;
+		}
+		data[0] = _page << 4;
+		memcpy(data + 1, _eeprom + _page * 16, 16);
+		_page = (_page + 1) & 15;
+		return 17;
+	}
+
+	int interrupt_transfer(unsigned char, unsigned char *data, int length, int *transferred,
+			unsigned int timeout) {
+		*transferred = 0;
+		if (!_subscribed) {
+			int ret = _transport.request(protocol::SUBSCRIBE, _index, 0, 0);
+			if (ret < 0)
+				return ret;
+			_subscribed = true;
+		}
+
+		deque<vector<unsigned char> > &queue = _transport.reports(_index);
+		double end = now_ms() + timeout;
+		while (queue.empty()) {
+			int left = int(end - now_ms());
+			if (left < 0)
+				return LIBUSB_ERROR_TIMEOUT;
+			int ret = _transport.receive(left);
+			if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED)
+				return ret;
+		}
+
+		const vector<unsigned char> &report = queue.front();
+		int n = length < int(report.size()) ? length : report.size();
+		memcpy(data, &report[0], n);
+		*transferred = n;
+		bool overflow = n < int(report.size());
+		queue.pop_front();
+		return overflow ? LIBUSB_ERROR_OVERFLOW : 0;
+	}
+
+	async_transfer *alloc_control_transfer();
+	async_transfer *alloc_interrupt_transfer(unsigned char, int) { return 0; } // see interrupt_transfer()
+
+	void invalidate() { _eeprom_valid = false; }
+
+	// from the LIST reply
+	uint8_t bus;
+	uint8_t addr;
+	libusb_device_descriptor desc;
+	string strings[3];
+	vector<unsigned char> report_descriptor;
+
+private:
+	remote_transport &_transport;
+	uint8_t _index;
+	uint8_t _eeprom[256];
+	bool _eeprom_valid;
+	int _page;
+	bool _subscribed;
+};
+
+
+
+// an EEPROM write (FEATURE SET_REPORT with address and value)
+class remote_transfer : public async_transfer {
+public:
+	remote_transfer(remote_transport &t, remote_device &d, uint8_t index) :
+		_transport(t), _device(d), _index(index) {}
+	~remote_transfer() { _transport.forget(this); }
+
+	int submit(unsigned char *buf, unsigned int) {
+		if (buf[0] != 0x21 || buf[1] != 0x09 || buf[6] != 2 || buf[7] != 0)
+			return LIBUSB_ERROR_NOT_SUPPORTED;
+		uint32_t tag;
+		int ret = _transport.send(protocol::WRITE, _index, buf + LIBUSB_CONTROL_SETUP_SIZE, 2, &tag);
+		if (ret < 0)
+			return ret;
+		_transport.submitted(tag, this);
+		return 0;
+	}
+
+	// the daemon finishes what it got
+	int cancel() { return LIBUSB_ERROR_NOT_SUPPORTED; }
+
+	void complete(int status) {
+		_device.invalidate();
+		done(this, status);
+	}
+
+private:
+	remote_transport &_transport;
+	remote_device &_device;
+	uint8_t _index;
+};
+
+
+
+async_transfer *remote_device::alloc_control_transfer()
+{
+	return new remote_transfer(_transport, *this, _index);
+}
+
+
+
+remote_transport *remote_transport::connect(const char *path)
+{
+	string p = path ? path : protocol::socket_path();
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (p.size() >= sizeof(addr.sun_path))
+		return 0;
+	strcpy(addr.sun_path, p.c_str());
+
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return 0;
+	if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+		close(fd);
+		return 0;
+	}
+	if (!protocol::same_user(fd)) { // anyone can create a socket in /tmp
+		log(WARN) << "ignoring " << p << ": bu0836d there runs as another user" << endl;
+		close(fd);
+		return 0;
+	}
+	log(INFO) << "using bu0836d on " << p << endl;
+	return new remote_transport(fd);
+}
+
+
+
+remote_transport::~remote_transport()
+{
+	if (_fd >= 0)
+		close(_fd);
+}
+
+
+
+int remote_transport::open_devices(vector<usb_device *> &devices)
+{
+	vector<unsigned char> list;
+	int ret = request(protocol::LIST, 0, 0, 0, &list);
+	if (ret < 0)
+		throw string("bu0836d: ") + usb_strerror(ret);
+
+	const unsigned char *p = list.empty() ? 0 : &list[0], *end = p + list.size();
+	const char *malformed = "bu0836d: malformed device list";
+	if (p == end)
+		throw string(malformed);
+	int num = *p++;
+	for (int i = 0; i < num; i++) {
+		if (end - p < int(2 + sizeof(libusb_device_descriptor)))
+			throw string(malformed);
+		remote_device *d = new remote_device(*this, i);
+		devices.push_back(d);
+		d->bus = *p++;
+		d->addr = *p++;
+		memcpy(&d->desc, p, sizeof(d->desc));
+		p += sizeof(d->desc);
+		for (int k = 0; k < 3; k++) {
+			if (p == end || end - p - 1 < *p)
+				throw string(malformed);
+			d->strings[k].assign(reinterpret_cast<const char *>(p + 1), *p);
+			p += 1 + *p;
+		}
+		d->desc.iManufacturer = 1;
+		d->desc.iProduct = 2;
+		d->desc.iSerialNumber = 3;
+
+		if (end - p < 2)
+			throw string(malformed);
+		uint16_t len;
+		memcpy(&len, p, 2);
+		p += 2;
+		if (end - p < len)
+			throw string(malformed);
+		d->report_descriptor.assign(p, p + len);
+		p += len;
+	}
+	return 0;
+}
+
+
+
+int remote_transport::handle_events()
+{
+	return receive(-1);
+}
+
+
+
+int remote_transport::get_pollfds(vector<pollfd> &fds, int *timeout)
+{
+	if (_fd < 0)
+		return LIBUSB_ERROR_NO_DEVICE;
+	pollfd pfd = { _fd, POLLIN, 0 };
+	fds.push_back(pfd);
+	*timeout = -1;
+	return 0;
+}
+
+
+
+int remote_transport::poll_events()
+{
+	int ret = receive(0);
+	return ret == LIBUSB_ERROR_TIMEOUT ? 0 : ret;
+}
+
+
+
+int remote_transport::send(uint8_t type, uint8_t device, const void *data, uint16_t length, uint32_t *tag)
+{
+	if (_fd < 0)
+		return LIBUSB_ERROR_NO_DEVICE;
+
+	protocol::header h = { type, device, length, ++_tag, 0 };
+	vector<char> buf(sizeof(h) + length);
+	memcpy(&buf[0], &h, sizeof(h));
+	if (length)
+		memcpy(&buf[sizeof(h)], data, length);
+
+	ssize_t n;
+	while ((n = ::send(_fd, &buf[0], buf.size(), MSG_NOSIGNAL)) < 0 && errno == EINTR)
+		;
+	if (n < 0)
+		return fail(LIBUSB_ERROR_NO_DEVICE);
+	if (tag)
+		*tag = h.tag;
+	return 0;
+}
+
+
+
+// Sends a request and waits for its reply. Returns the reply's status.
+int remote_transport::request(uint8_t type, uint8_t device, const void *data, uint16_t length,
+		vector<unsigned char> *reply)
+{
+	uint32_t tag;
+	int ret = send(type, device, data, length, &tag);
+	if (ret < 0)
+		return ret;
+
+	map<uint32_t, pair<int, vector<unsigned char> > >::iterator it;
+	while ((it = _replies.find(tag)) == _replies.end())
+		if ((ret = receive(-1)) < 0 && ret != LIBUSB_ERROR_INTERRUPTED)
+			return ret;
+
+	ret = it->second.first;
+	if (reply)
+		reply->swap(it->second.second);
+	_replies.erase(it);
+	return ret;
+}
+
+
+
+// Waits up to timeout ms (-1: forever) for one message and files it.
+int remote_transport::receive(int timeout)
+{
+	if (_fd < 0)
+		return LIBUSB_ERROR_NO_DEVICE;
+
+	pollfd pfd = { _fd, POLLIN, 0 };
+	int ret = poll(&pfd, 1, timeout);
+	if (ret < 0)
+		return errno == EINTR ? LIBUSB_ERROR_INTERRUPTED : fail(LIBUSB_ERROR_IO);
+	if (!ret)
+		return LIBUSB_ERROR_TIMEOUT;
+
+	protocol::header h;
+	iovec iov[2] = { { &h, sizeof(h) }, { &_buf[0], _buf.size() } };
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+	ssize_t n;
+	while ((n = recvmsg(_fd, &msg, 0)) < 0 && errno == EINTR)
+		;
+	if (n <= 0)
+		return fail(LIBUSB_ERROR_NO_DEVICE);
+	if (size_t(n) < sizeof(h) || size_t(n) != sizeof(h) + h.length)
+		return fail(LIBUSB_ERROR_IO);
+	const unsigned char *payload = &_buf[0];
+
+	if (h.type == protocol::REPORT) {
+		deque<vector<unsigned char> > &queue = _reports[h.device];
+		queue.push_back(vector<unsigned char>(payload, payload + h.length));
+		if (queue.size() > MAX_QUEUED_REPORTS)
+			queue.pop_front();
+		return 0;
+	}
+
+	map<uint32_t, remote_transfer *>::iterator it = _pending.find(h.tag);
+	if (it != _pending.end()) {
+		remote_transfer *t = it->second;
+		_pending.erase(it);
+		t->complete(h.status);
+		return 0;
+	}
+
+	_replies[h.tag] = make_pair(int(h.status), vector<unsigned char>(payload, payload + h.length));
+	return 0;
+}
+
+
+
+void remote_transport::forget(remote_transfer *t)
+{
+	map<uint32_t, remote_transfer *>::iterator it;
+	for (it = _pending.begin(); it != _pending.end(); ++it) {
+		if (it->second == t) {
+			_pending.erase(it);
+			return;
+		}
+	}
+}
+
+
+
+// The daemon is gone: finish all writes in flight, so that nobody waits for them.
+int remote_transport::fail(int error)
+{
+	if (_fd >= 0) {
+		log(ALERT) << "bu0836d: connection lost" << endl;
+		close(_fd);
+		_fd = -1;
+	}
+
+	map<uint32_t, remote_transfer *> pending;
+	pending.swap(_pending);
+	map<uint32_t, remote_transfer *>::iterator it;
+	for (it = pending.begin(); it != pending.end(); ++it)
+		it->second->complete(LIBUSB_TRANSFER_NO_DEVICE);
+	return error;
+}
+
+} // namespace bu0836
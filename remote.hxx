@@ -0,0 +1,113 @@
+// bu0836d protocol and client transport
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#ifndef _REMOTE_HXX_
+#define _REMOTE_HXX_
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "transport.hxx"
+
+
+
+namespace bu0836 {
+
+// bu0836d keeps all controllers claimed, with their descriptors and EEPROM
+// image cached, and serves them on a Unix domain socket (SOCK_SEQPACKET).
+// Every packet is one message: a header plus `length' bytes of payload, in
+// host byte order.
+//
+//   LIST         -> payload: count, then per device: bus, address,
+//                   libusb_device_descriptor, manufacturer, product, serial
+//                   (each a length byte and the string), report descriptor
+//                   (16 bit length and the data)
+//   READ         -> payload: the device's 256 byte EEPROM image
+//   WRITE        payload: address, value -> status: libusb_transfer_status
+//   SUBSCRIBE    -> then REPORT messages with the raw input reports (dropped
+//                   when the client doesn't keep up)
+//   UNSUBSCRIBE
+//
+// Replies have the type and tag of the request and a libusb error code
+// (WRITE: libusb_transfer_status) in status.
+namespace protocol {
+
+enum { LIST = 1, READ, WRITE, SUBSCRIBE, UNSUBSCRIBE, REPORT };
+enum { MAX_PAYLOAD = 65535 };
+
+struct header {
+	uint8_t type;
+	uint8_t device;      // index in the LIST reply
+	uint16_t length;     // of the payload
+	uint32_t tag;        // chosen by the client, copied to the reply
+	int32_t status;      // replies only
+};
+
+// $BU0836_SOCKET, or bu0836.sock in $XDG_RUNTIME_DIR, or /tmp/bu0836-UID.sock
+std::string socket_path();
+
+// whether the other end of a connected socket runs as our user
+bool same_user(int fd);
+
+} // namespace protocol
+
+
+
+class remote_device;
+class remote_transfer;
+
+// Client side of bu0836d: a transport whose devices are the daemon's
+// controllers. Claiming is a no-op (the daemon holds the interfaces), the
+// EEPROM is read from the daemon's cache, writes and input reports go
+// through the daemon.
+class remote_transport : public transport {
+public:
+	// Returns 0 if no daemon is listening on path (default: socket_path()).
+	static remote_transport *connect(const char *path = 0);
+	~remote_transport();
+	int open_devices(std::vector<usb_device *> &devices);
+	int handle_events();
+	int get_pollfds(std::vector<pollfd> &fds, int *timeout);
+	int poll_events();
+
+	// for remote_device and remote_transfer
+	int send(uint8_t type, uint8_t device, const void *data, uint16_t length, uint32_t *tag = 0);
+	int request(uint8_t type, uint8_t device, const void *data, uint16_t length,
+			std::vector<unsigned char> *reply = 0);
+	int receive(int timeout);
+	void submitted(uint32_t tag, remote_transfer *t) { _pending[tag] = t; }
+	void forget(remote_transfer *t);
+	std::deque<std::vector<unsigned char> > &reports(uint8_t device) { return _reports[device]; }
+
+private:
+	explicit remote_transport(int fd) : _fd(fd), _tag(0), _buf(protocol::MAX_PAYLOAD) {}
+	int fail(int error);
+
+	int _fd;
+	uint32_t _tag;
+	std::vector<unsigned char> _buf;                         // for receive()
+	std::map<uint32_t, remote_transfer *> _pending;          // WRITEs in flight
+	std::map<uint32_t, std::pair<int, std::vector<unsigned char> > > _replies;
+	std::map<uint8_t, std::deque<std::vector<unsigned char> > > _reports;
+};
+
+} // namespace bu0836
+
+#endif
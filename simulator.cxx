@@ -0,0 +1,449 @@
+// simulated BU0836A
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+
+#include "simulator.hxx"
+
+using namespace std;
+
+
+
+namespace bu0836 {
+
+namespace {
+
+const int CONTROL_US = 1000;  // per control transfer, or per batch of asynchronous ones
+const int REPORT_SIZE = 22;
+
+
+
+uint64_t now_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+// 8 axes (12 bit data in 16 bit fields), hat, 32 buttons
+const unsigned char report_descriptor[] = {
+	0x05, 0x01, 0x09, 0x04, 0xa1, 0x01,
+	0x09, 0x01, 0xa1, 0x00,
+	0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x33, 0x09, 0x34, 0x09, 0x35, 0x09, 0x36, 0x09, 0x36,
+	0x15, 0x00, 0x26, 0xff, 0x0f, 0x75, 0x10, 0x95, 0x08, 0x81, 0x02,
+	0xc0,
+	0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x35, 0x00, 0x46, 0x3b, 0x01, 0x65, 0x14,
+	0x75, 0x04, 0x95, 0x01, 0x81, 0x42,
+	0x75, 0x04, 0x95, 0x01, 0x81, 0x03,
+	0x05, 0x09, 0x19, 0x01, 0x29, 0x20, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x20, 0x81, 0x02,
+	0x75, 0x07, 0x95, 0x01, 0x81, 0x03,
+	0xc0,
+};
+
+const unsigned char hid_descriptor[] = {
+	9, LIBUSB_DT_HID, 0x10, 0x01, 0, 1, LIBUSB_DT_REPORT,
+	sizeof(report_descriptor) & 0xff, sizeof(report_descriptor) >> 8,
+};
+
+
+
+int copy(unsigned char *buf, int length, const void *data, int size)
+{
+	if (size > length)
+		size = length;
+	memcpy(buf, data, size);
+	return size;
+}
+
+} // namespace
+
+
+
+// endpoint 0 for control transfers
+class simulated_transfer : public async_transfer {
+public:
+	simulated_transfer(simulator &s, simulator::board &b, unsigned char endpoint = 0, int length = 0) :
+		_simulator(s), _board(b), _endpoint(endpoint), _length(length), _buf(0), _queued(false),
+		_cancelled(false) {}
+	~simulated_transfer() { if (_queued) _simulator.unqueue(this); }
+
+	int submit(unsigned char *buf, unsigned int) {
+		if (_queued)
+			return LIBUSB_ERROR_BUSY;
+		_buf = buf;
+		_queued = true;
+		_cancelled = false;
+		_simulator.queue(this);
+		return 0;
+	}
+
+	int cancel() {
+		if (!_queued)
+			return LIBUSB_ERROR_NOT_FOUND;
+		_cancelled = true;
+		return 0;
+	}
+
+	// simulated time at which complete() is due: control transfers in the
+	// next batch, interrupt transfers with the next input report
+	uint64_t due() const { return _endpoint && !_cancelled ? _board.next_report : 0; }
+
+	// called by simulator::handle_events() and poll_events()
+	void complete() {
+		_queued = false;
+		transferred = 0;
+		if (_cancelled) {
+			done(this, LIBUSB_TRANSFER_CANCELLED);
+			return;
+		}
+		if (_endpoint) {
+			int ret = _simulator.input_report(_board, _buf, _length, &transferred, 0);
+			done(this, ret == LIBUSB_ERROR_OVERFLOW ? LIBUSB_TRANSFER_OVERFLOW
+					: ret < 0 ? LIBUSB_TRANSFER_ERROR : LIBUSB_TRANSFER_COMPLETED);
+			return;
+		}
+		uint16_t value = libusb_le16_to_cpu(_buf[2] | _buf[3] << 8);
+		uint16_t length = libusb_le16_to_cpu(_buf[6] | _buf[7] << 8);
+		int ret = _simulator.control(_board, _buf[0], _buf[1], value, _buf + LIBUSB_CONTROL_SETUP_SIZE,
+				length);
+		if (ret > 0)
+			transferred = ret;
+		done(this, ret < 0 ? LIBUSB_TRANSFER_ERROR : LIBUSB_TRANSFER_COMPLETED);
+	}
+
+private:
+	simulator &_simulator;
+	simulator::board &_board;
+	unsigned char _endpoint;
+	int _length;
+	unsigned char *_buf;
+	bool _queued;
+	bool _cancelled;
+};
+
+
+
+namespace {
+
+class simulated_device : public usb_device {
+public:
+	simulated_device(simulator &s, simulator::board &b, int address) :
+		_simulator(s), _board(b), _address(address), _claimed(false) {}
+	~simulated_device() { if (_claimed) _board.claimed = false; }
+
+	int bus_number() { return 0; }
+	int address() { return _address; }
+
+	int get_device_descriptor(libusb_device_descriptor *desc) {
+		memset(desc, 0, sizeof(*desc));
+		desc->bLength = LIBUSB_DT_DEVICE_SIZE;
+		desc->bDescriptorType = LIBUSB_DT_DEVICE;
+		desc->bcdUSB = 0x0110;
+		desc->bMaxPacketSize0 = 8;
+		desc->idVendor = 0x16c0;
+		desc->idProduct = 0x05ba;
+		desc->bcdDevice = 0x0121;
+		desc->iManufacturer = 1;
+		desc->iProduct = 2;
+		desc->iSerialNumber = 3;
+		desc->bNumConfigurations = 1;
+		return 0;
+	}
+
+	int get_string_descriptor_ascii(uint8_t index, unsigned char *buf, int length) {
+		const char *s = index == 1 ? "Leo Bodnar" : index == 2 ? "BU0836A Interface"
+				: index == 3 ? _board.serial.c_str() : 0;
+		if (!s)
+			return LIBUSB_ERROR_INVALID_PARAM;
+		return copy(buf, length, s, strlen(s));
+	}
+
+	int get_descriptor(uint8_t type, uint8_t, unsigned char *buf, int length) {
+		_simulator.advance(CONTROL_US);
+		if (type == LIBUSB_DT_HID)
+			return copy(buf, length, hid_descriptor, sizeof(hid_descriptor));
+		if (type == LIBUSB_DT_REPORT)
+			return copy(buf, length, report_descriptor, sizeof(report_descriptor));
+		return LIBUSB_ERROR_PIPE;
+	}
+
+	int kernel_driver_active(int) { return 0; }
+	int detach_kernel_driver(int) { return LIBUSB_ERROR_NOT_FOUND; }
+	int attach_kernel_driver(int) { return LIBUSB_ERROR_NOT_FOUND; }
+
+	int claim_interface(int) {
+		if (_board.claimed && !_claimed)
+			return LIBUSB_ERROR_BUSY;
+		_board.claimed = _claimed = true;
+		return 0;
+	}
+
+	int release_interface(int) {
+		if (!_claimed)
+			return LIBUSB_ERROR_NOT_FOUND;
+		_board.claimed = _claimed = false;
+		return 0;
+	}
+
+	int control_transfer(uint8_t request_type, uint8_t request, uint16_t value, uint16_t,
+			unsigned char *data, uint16_t length, unsigned int) {
+		_simulator.advance(CONTROL_US);
+		return _simulator.control(_board, request_type, request, value, data, length);
+	}
+
+	int interrupt_transfer(unsigned char endpoint, unsigned char *data, int length, int *transferred,
+			unsigned int timeout) {
+		*transferred = 0;
+		if (endpoint != (LIBUSB_ENDPOINT_IN | 1) || !_claimed)
+			return LIBUSB_ERROR_IO;
+		return _simulator.input_report(_board, data, length, transferred, timeout);
+	}
+
+	async_transfer *alloc_control_transfer() { return new simulated_transfer(_simulator, _board); }
+
+	async_transfer *alloc_interrupt_transfer(unsigned char endpoint, int length) {
+		return new simulated_transfer(_simulator, _board, endpoint, length);
+	}
+
+private:
+	simulator &_simulator;
+	simulator::board &_board;
+	int _address;
+	bool _claimed;
+};
+
+} // namespace
+
+
+
+simulator::simulator(const config &c) :
+	_config(c),
+	_boards(c.boards),
+	_clock(0),
+	_start(now_us()),
+	_random(c.seed),
+	_writes(0)
+{
+	for (size_t i = 0; i < _boards.size(); i++) {
+		board &b = _boards[i];
+		char serial[16];
+		snprintf(serial, sizeof(serial), "SIM%05u", unsigned(i + 1));
+		b.serial = serial;
+		memset(b.eeprom, 0, sizeof(b.eeprom));
+		b.eeprom[0x0c] = 1; // autodiscovery
+		b.eeprom[0x1a] = 6; // pulse width
+		b.page = 0;
+		b.next_report = 0;
+		b.reports = b.feature_reports = b.writes = 0;
+		b.claimed = false;
+	}
+}
+
+
+
+simulator::~simulator()
+{
+}
+
+
+
+int simulator::open_devices(vector<usb_device *> &devices)
+{
+	for (size_t i = 0; i < _boards.size(); i++)
+		devices.push_back(new simulated_device(*this, _boards[i], i + 1));
+	return 0;
+}
+
+
+
+// Completes all queued control transfers (as if they were all in the same
+// frame) and the interrupt transfers whose reports are due. If that is none,
+// waits for the next report.
+int simulator::handle_events()
+{
+	advance(CONTROL_US);
+	if (!complete_due() && !_queue.empty()) {
+		advance(next_due() - _clock);
+		complete_due();
+	}
+	return 0;
+}
+
+
+
+int simulator::get_pollfds(vector<pollfd> &, int *timeout)
+{
+	catch_up();
+	if (_queue.empty()) {
+		*timeout = -1;
+		return 0;
+	}
+	uint64_t due = next_due();
+	*timeout = due > _clock ? int((due - _clock + 999) / 1000) : 0;
+	return 0;
+}
+
+
+
+int simulator::poll_events()
+{
+	catch_up();
+	if (!_config.realtime && !_queue.empty() && next_due() > _clock)
+		advance(next_due() - _clock);  // as if poll() had waited
+	complete_due();
+	return 0;
+}
+
+
+
+// in realtime mode, takes over the time that passed outside of advance()
+void simulator::catch_up()
+{
+	if (!_config.realtime)
+		return;
+	uint64_t now = now_us() - _start;
+	if (now > _clock)
+		_clock = now;
+}
+
+
+
+uint64_t simulator::next_due() const
+{
+	uint64_t due = ~uint64_t(0);
+	for (size_t i = 0; i < _queue.size(); i++)
+		if (_queue[i]->due() < due)
+			due = _queue[i]->due();
+	return due;
+}
+
+
+
+// Returns the number of completed transfers.
+size_t simulator::complete_due()
+{
+	vector<simulated_transfer *> batch, waiting;
+	for (size_t i = 0; i < _queue.size(); i++)
+		(_queue[i]->due() <= _clock ? batch : waiting).push_back(_queue[i]);
+	_queue.swap(waiting);
+	for (size_t i = 0; i < batch.size(); i++)
+		batch[i]->complete();  // may queue new transfers for the next call
+	return batch.size();
+}
+
+
+
+void simulator::queue(simulated_transfer *t)
+{
+	_queue.push_back(t);
+}
+
+
+
+void simulator::unqueue(simulated_transfer *t)
+{
+	_queue.erase(remove(_queue.begin(), _queue.end(), t), _queue.end());
+}
+
+
+
+void simulator::advance(uint64_t us)
+{
+	_clock += us;
+	if (_config.realtime) {
+		const struct timespec ts = { time_t(us / 1000000), long(us % 1000000 * 1000) };
+		nanosleep(&ts, 0);
+	}
+}
+
+
+
+unsigned int simulator::random()
+{
+	_random = _random * 1103515245 + 12345;
+	return _random >> 16;
+}
+
+
+
+int simulator::control(board &b, uint8_t request_type, uint8_t request, uint16_t value, unsigned char *data,
+		uint16_t length)
+{
+	if (request_type == 0xa1 && request == 0x01 && value == 0x0300) { // GET_REPORT FEATURE
+		if (length < 17)
+			return LIBUSB_ERROR_OVERFLOW;
+		b.page = (b.page * 5 + 3) & 15;   // visits all 16 pages, but not in order
+		data[0] = b.page << 4;
+		memcpy(data + 1, b.eeprom + b.page * 16, 16);
+		b.feature_reports++;
+		return 17;
+	}
+
+	if (request_type == 0x21 && request == 0x09 && value == 0x0300 && length == 2) { // SET_REPORT FEATURE
+		if (_config.fail_every && ++_writes % _config.fail_every == 0)
+			return LIBUSB_ERROR_PIPE;
+		b.eeprom[data[0]] = data[1];
+		b.writes++;
+		return 2;
+	}
+
+	return LIBUSB_ERROR_PIPE;
+}
+
+
+
+int simulator::input_report(board &b, unsigned char *data, int length, int *transferred, unsigned int timeout)
+{
+	if (b.next_report < _clock)
+		b.next_report = _clock;
+	uint64_t wait = b.next_report - _clock;
+	if (wait > timeout * 1000ull) {
+		advance(timeout * 1000ull);
+		return LIBUSB_ERROR_TIMEOUT;
+	}
+	advance(wait);
+
+	int jitter = _config.jitter_us ? int(random() % (2 * _config.jitter_us + 1)) - _config.jitter_us : 0;
+	b.next_report += _config.interval_us + jitter > 0 ? _config.interval_us + jitter : 1;
+	unsigned long n = b.reports++;
+
+	unsigned char report[REPORT_SIZE];
+	for (int i = 0; i < 8; i++) {
+		unsigned int phase = n * (i + 1) * 16 % 8192;  // triangle wave, 0-4095
+		unsigned int v = phase < 4096 ? phase : 8191 - phase;
+		if (b.eeprom[0x0b] & (1 << i))                 // invert
+			v = 4095 - v;
+		report[i * 2] = v & 0xff;
+		report[i * 2 + 1] = v >> 8;
+	}
+	report[16] = n / 64 % 8;                            // hat
+	uint32_t buttons = 1u << (n / 16 % 32);
+	for (int i = 0; i < 4; i++)
+		report[17 + i] = buttons >> (i * 8) & 0xff;
+	report[21] = 0;
+
+	if (length < REPORT_SIZE)
+		return LIBUSB_ERROR_OVERFLOW;
+	*transferred = copy(data, length, report, REPORT_SIZE);
+	return 0;
+}
+
+} // namespace bu0836
@@ -0,0 +1,103 @@
+// simulated BU0836A
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#ifndef _SIMULATOR_HXX_
+#define _SIMULATOR_HXX_
+
+#include <string>
+#include <vector>
+
+#include "transport.hxx"
+
+
+
+namespace bu0836 {
+
+class simulated_transfer;
+
+// A transport with BU0836A boards in software, for tests and benchmarks
+// without hardware. Each board has a 256 byte EEPROM that it delivers in 16
+// byte pages in its own cyclic order on FEATURE GET_REPORT, takes single
+// byte SET_REPORT writes, and sends input reports with moving axes, a hat
+// and buttons at a fixed interval plus pseudo-random jitter.
+//
+// Time is simulated: a control transfer takes 1 ms, and an interrupt
+// transfer waits for the next report. With config::realtime these waits
+// really sleep (and poll_events() catches up with the time spent waiting
+// in poll()); otherwise everything runs at full speed, and the same config
+// always gives the same results.
+class simulator : public transport {
+public:
+	struct config {
+		config() : boards(1), interval_us(4000), jitter_us(500), realtime(true), seed(0x0836),
+				fail_every(0) {}
+		int boards;
+		int interval_us;             // between input reports
+		int jitter_us;               // max. deviation from interval_us
+		bool realtime;
+		unsigned int seed;           // for the jitter
+		unsigned int fail_every;     // fail every nth EEPROM write (0 = never)
+	};
+
+	struct board {
+		std::string serial;
+		uint8_t eeprom[256];
+		int page;                    // last page delivered
+		uint64_t next_report;        // simulated time in us
+		unsigned long reports;
+		unsigned long feature_reports;
+		unsigned long writes;
+		bool claimed;
+	};
+
+	explicit simulator(const config &c = config());
+	~simulator();
+	int open_devices(std::vector<usb_device *> &devices);
+	int handle_events();
+	int get_pollfds(std::vector<pollfd> &fds, int *timeout);
+	int poll_events();
+
+	const std::vector<board> &boards() const { return _boards; }
+	uint64_t clock_us() const { return _clock; }
+
+	// for the simulated devices and transfers
+	void advance(uint64_t us);
+	int control(board &b, uint8_t request_type, uint8_t request, uint16_t value, unsigned char *data,
+			uint16_t length);
+	int input_report(board &b, unsigned char *data, int length, int *transferred, unsigned int timeout);
+	void queue(simulated_transfer *t);
+	void unqueue(simulated_transfer *t);
+
+private:
+	unsigned int random();
+	void catch_up();
+	uint64_t next_due() const;
+	size_t complete_due();
+
+	config _config;
+	std::vector<board> _boards;
+	std::vector<simulated_transfer *> _queue;
+	uint64_t _clock;
+	uint64_t _start;             // real time at _clock 0, in us
+	unsigned int _random;
+	unsigned long _writes;
+};
+
+} // namespace bu0836
+
+#endif
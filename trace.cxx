@@ -0,0 +1,252 @@
+// USB call tracing
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <time.h>
+
+#include "logging.hxx"
+#include "trace.hxx"
+
+using namespace std;
+using namespace logging;
+
+
+
+namespace trace {
+
+bool active = false;
+unsigned long calls = 0;
+bool timing = false;
+
+
+
+namespace {
+
+struct entry {
+	const char *name;
+	int lane;
+	int result;
+	int nargs;
+	uint64_t start;
+	uint64_t end;
+	const char *keys[span::MAX_ARGS];
+	long values[span::MAX_ARGS];
+};
+
+const unsigned long CAPACITY = 16384;
+
+entry *records = 0;        // preallocated by start()
+unsigned long num_records = 0;
+uint64_t epoch = 0;
+string output;
+
+
+
+void write_json()
+{
+	FILE *f = fopen(output.c_str(), "w");
+	if (!f) {
+		log(ALERT) << "trace: cannot write to '" << output << '\'' << endl;
+		return;
+	}
+
+	unsigned long n = num_records < CAPACITY ? num_records : CAPACITY;
+	int max_lane = 0;
+	fprintf(f, "{\"traceEvents\":[\n");
+	for (unsigned long i = 0; i < n; i++) {
+		const entry &r = records[i];
+		if (r.lane > max_lane)
+			max_lane = r.lane;
+		fprintf(f, "{\"name\":\"%s\",\"cat\":\"usb\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+				"\"ts\":%llu,\"dur\":%llu,\"args\":{", r.name, r.lane + 1,
+				(unsigned long long)(r.start - epoch), (unsigned long long)(r.end - r.start));
+		for (int k = 0; k < r.nargs; k++)
+			fprintf(f, "\"%s\":%ld,", r.keys[k], r.values[k]);
+		fprintf(f, "\"result\":%d}},\n", r.result);
+	}
+
+	for (int lane = 0; lane <= max_lane; lane++)
+		fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"name\":\"%s %d\"}},\n", lane + 1, lane ? "async" : "main", lane);
+	fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"bu0836\"}}\n");
+	fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+
+	if (fclose(f))
+		log(ALERT) << "trace: error writing '" << output << '\'' << endl;
+	else if (num_records > CAPACITY)
+		log(WARN) << "trace: buffer full, " << num_records - CAPACITY << " calls not recorded" << endl;
+}
+
+
+
+struct writer {
+	~writer() {
+		if (!active)
+			return;
+		active = false;
+		write_json();
+		delete [] records;
+	}
+} write_at_exit;
+
+
+
+struct phase_entry {
+	const char *name;
+	int parent;
+	unsigned int count;
+	uint64_t us;
+	unsigned long calls;
+	uint64_t start;             // of the current run
+	unsigned long start_calls;
+};
+
+vector<phase_entry> phases;     // in order of first entry, so parents come first
+int current_phase = -1;
+uint64_t timing_epoch = 0;
+
+
+
+void print_phases(int parent, int depth)
+{
+	for (size_t i = 0; i < phases.size(); i++) {
+		const phase_entry &p = phases[i];
+		if (p.parent != parent)
+			continue;
+
+		ostringstream name;
+		name << string(depth * 2, ' ') << p.name;
+		if (p.count > 1)
+			name << " (" << p.count << "x)";
+		cerr << "  " << left << setw(32) << name.str() << right << setw(10) << p.us / 1e3
+				<< setw(8) << p.calls << endl;
+		print_phases(i, depth + 1);
+	}
+}
+
+
+
+struct timing_report {
+	~timing_report() {
+		if (!timing)
+			return;
+		timing = false;
+		logging::flush();
+		cerr << "timing:" << endl;
+		cerr << "  " << left << setw(32) << "phase" << right << setw(10) << "ms" << setw(8) << "USB" << endl;
+		cerr << fixed << setprecision(3);
+		print_phases(-1, 0);
+		cerr << "  " << left << setw(32) << "total" << right << setw(10) << (now_us() - timing_epoch) / 1e3
+				<< setw(8) << __atomic_load_n(&calls, __ATOMIC_RELAXED) << endl;
+	}
+} print_timing_at_exit;
+
+} // namespace
+
+
+
+uint64_t now_us()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+
+void start(const char *path)
+{
+	if (active)
+		return;
+	output = path;
+	records = new entry[CAPACITY];
+	epoch = now_us();
+	active = true;
+}
+
+
+
+void start_timing()
+{
+#ifdef BU0836_NO_TIMING
+	log(WARN) << "timing: not available in this build" << endl;
+#else
+	timing_epoch = now_us();
+	timing = true;
+#endif
+}
+
+
+
+int phase::enter(const char *name)
+{
+	size_t i;
+	for (i = 0; i < phases.size(); i++)
+		if (phases[i].parent == current_phase && !strcmp(phases[i].name, name))
+			break;
+
+	if (i == phases.size()) {
+		phase_entry p = { name, current_phase, 0, 0, 0, 0, 0 };
+		phases.push_back(p);
+	}
+
+	phases[i].start = now_us();
+	phases[i].start_calls = __atomic_load_n(&calls, __ATOMIC_RELAXED);
+	current_phase = i;
+	return i;
+}
+
+
+
+void phase::leave(int index)
+{
+	phase_entry &p = phases[index];
+	p.us += now_us() - p.start;
+	p.calls += __atomic_load_n(&calls, __ATOMIC_RELAXED) - p.start_calls;
+	p.count++;
+	current_phase = p.parent;
+}
+
+
+
+void span::record(int result) const
+{
+	unsigned long i = __atomic_fetch_add(&num_records, 1, __ATOMIC_RELAXED);
+	if (i >= CAPACITY)
+		return;
+
+	entry &r = records[i];
+	r.name = _name;
+	r.lane = _lane;
+	r.result = result;
+	r.nargs = _nargs;
+	r.start = _start;
+	r.end = now_us();
+	for (int k = 0; k < _nargs; k++) {
+		r.keys[k] = _keys[k];
+		r.values[k] = _values[k];
+	}
+}
+
+} // namespace trace
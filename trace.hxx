@@ -0,0 +1,114 @@
+// USB call tracing
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#ifndef _TRACE_HXX_
+#define _TRACE_HXX_
+
+#include <stdint.h>
+
+
+
+namespace trace {
+
+extern bool active;          // set by start()
+extern unsigned long calls;  // number of traced calls, counted even if tracing is off
+
+// Records all spans from now on and writes them to path as Chrome trace
+// event JSON at exit (load with chrome://tracing or ui.perfetto.dev).
+void start(const char *path);
+uint64_t now_us();
+
+
+
+// One traced call. Create it right before the call and pass the call's
+// result through end():
+//
+//     trace::span t("libusb_claim_interface");
+//     t.arg("interface", 0);
+//     int ret = t.end(libusb_claim_interface(handle, 0));
+//
+// Spans that overlap without nesting (async transfers) need their own lane.
+class span {
+public:
+	span() : _name(0), _lane(0), _nargs(0), _start(0) {}
+	explicit span(const char *name, int lane = 0) : _name(name), _lane(lane), _nargs(0),
+			_start(active ? now_us() : 0)
+	{
+		__atomic_add_fetch(&calls, 1, __ATOMIC_RELAXED);
+	}
+
+	span &arg(const char *key, long value) {
+		if (_nargs < MAX_ARGS) {
+			_keys[_nargs] = key;
+			_values[_nargs++] = value;
+		}
+		return *this;
+	}
+
+	int end(int result) {
+		if (active && _name)
+			record(result);
+		return result;
+	}
+
+	enum { MAX_ARGS = 4 };
+
+private:
+	void record(int result) const;
+
+	const char *_name;           // string literals only; they're written at exit
+	int _lane;
+	int _nargs;
+	uint64_t _start;
+	const char *_keys[MAX_ARGS];
+	long _values[MAX_ARGS];
+};
+
+
+// Wall time and USB call count of a program phase, printed by --timing.
+// Phases nest, and phases of the same name and parent are summed up. They
+// are only meant to be used from the main thread. Use TIMING_PHASE(), which
+// compiles to nothing with -DBU0836_NO_TIMING.
+extern bool timing;          // set by start_timing()
+
+// Enables phase timing and prints the phases to stderr at exit.
+void start_timing();
+
+class phase {
+public:
+	explicit phase(const char *name) : _index(timing && name ? enter(name) : -1) {}
+	~phase() { if (_index >= 0) leave(_index); }
+
+private:
+	static int enter(const char *name);
+	static void leave(int index);
+
+	int _index;
+};
+
+} // namespace trace
+
+#ifdef BU0836_NO_TIMING
+#define TIMING_PHASE(name)
+#else
+#define TIMING_PHASE(name) trace::phase TIMING_CONCAT(timing_phase_, __LINE__)(name)
+#endif
+#define TIMING_CONCAT(a, b) TIMING_DO_CONCAT(a, b)
+#define TIMING_DO_CONCAT(a, b) a##b
+
+#endif
@@ -0,0 +1,255 @@
+// USB transport
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#include <iostream>
+#include <string>
+
+#include "logging.hxx"
+#include "trace.hxx"
+#include "transport.hxx"
+
+using namespace std;
+using namespace logging;
+
+
+
+namespace bu0836 {
+
+namespace {
+
+const int CONTEXT = 0; // libusb's default context
+
+
+
+// endpoint 0 for control transfers
+class libusb_async_transfer : public async_transfer {
+public:
+	libusb_async_transfer(libusb_device_handle *handle, libusb_transfer *transfer, unsigned char endpoint = 0,
+			int length = 0) :
+		_handle(handle), _transfer(transfer), _endpoint(endpoint), _length(length) {}
+	~libusb_async_transfer() { libusb_free_transfer(_transfer); }
+
+	int submit(unsigned char *buf, unsigned int timeout) {
+		if (_endpoint)
+			libusb_fill_interrupt_transfer(_transfer, _handle, _endpoint, buf, _length, completed, this,
+					timeout);
+		else
+			libusb_fill_control_transfer(_transfer, _handle, buf, completed, this, timeout);
+		return libusb_submit_transfer(_transfer);
+	}
+
+	int cancel() { return libusb_cancel_transfer(_transfer); }
+
+private:
+	static void completed(libusb_transfer *transfer) {
+		libusb_async_transfer *t = static_cast<libusb_async_transfer *>(transfer->user_data);
+		t->transferred = transfer->actual_length;
+		t->done(t, transfer->status);
+	}
+
+	libusb_device_handle *_handle;
+	libusb_transfer *_transfer;
+	unsigned char _endpoint;
+	int _length;
+};
+
+
+
+class libusb_usb_device : public usb_device {
+public:
+	explicit libusb_usb_device(libusb_device_handle *handle) : _handle(handle) {}
+
+	~libusb_usb_device() {
+		trace::span t("libusb_close");
+		libusb_close(_handle);
+		t.end(0);
+	}
+
+	int bus_number() { return libusb_get_bus_number(libusb_get_device(_handle)); }
+	int address() { return libusb_get_device_address(libusb_get_device(_handle)); }
+
+	int get_device_descriptor(libusb_device_descriptor *desc) {
+		return libusb_get_device_descriptor(libusb_get_device(_handle), desc);
+	}
+
+	int get_string_descriptor_ascii(uint8_t index, unsigned char *buf, int length) {
+		return libusb_get_string_descriptor_ascii(_handle, index, buf, length);
+	}
+
+	int get_descriptor(uint8_t type, uint8_t index, unsigned char *buf, int length) {
+		return libusb_get_descriptor(_handle, type, index, buf, length);
+	}
+
+	int kernel_driver_active(int interface) { return libusb_kernel_driver_active(_handle, interface); }
+	int detach_kernel_driver(int interface) { return libusb_detach_kernel_driver(_handle, interface); }
+	int attach_kernel_driver(int interface) { return libusb_attach_kernel_driver(_handle, interface); }
+	int claim_interface(int interface) { return libusb_claim_interface(_handle, interface); }
+	int release_interface(int interface) { return libusb_release_interface(_handle, interface); }
+
+	int control_transfer(uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+			unsigned char *data, uint16_t length, unsigned int timeout) {
+		return libusb_control_transfer(_handle, request_type, request, value, index, data, length, timeout);
+	}
+
+	int interrupt_transfer(unsigned char endpoint, unsigned char *data, int length, int *transferred,
+			unsigned int timeout) {
+		return libusb_interrupt_transfer(_handle, endpoint, data, length, transferred, timeout);
+	}
+
+	async_transfer *alloc_control_transfer() {
+		libusb_transfer *t = libusb_alloc_transfer(0);
+		return t ? new libusb_async_transfer(_handle, t) : 0;
+	}
+
+	async_transfer *alloc_interrupt_transfer(unsigned char endpoint, int length) {
+		libusb_transfer *t = libusb_alloc_transfer(0);
+		return t ? new libusb_async_transfer(_handle, t, endpoint, length) : 0;
+	}
+
+private:
+	libusb_device_handle *_handle;
+};
+
+} // namespace
+
+
+
+const char *usb_strerror(int error)
+{
+	switch (error) {
+	case LIBUSB_SUCCESS:
+		return "success";
+	case LIBUSB_ERROR_IO:
+		return "input/output error";
+	case LIBUSB_ERROR_INVALID_PARAM:
+		return "invalid parameter";
+	case LIBUSB_ERROR_ACCESS:
+		return "access denied (insufficient permissions)";
+	case LIBUSB_ERROR_NO_DEVICE:
+		return "no such device (it may have been disconnected)";
+	case LIBUSB_ERROR_NOT_FOUND:
+		return "entity not found";
+	case LIBUSB_ERROR_BUSY:
+		return "resource busy";
+	case LIBUSB_ERROR_TIMEOUT:
+		return "operation timed out";
+	case LIBUSB_ERROR_OVERFLOW:
+		return "overflow";
+	case LIBUSB_ERROR_PIPE:
+		return "pipe error";
+	case LIBUSB_ERROR_INTERRUPTED:
+		return "system call interrupted (perhaps due to signal)";
+	case LIBUSB_ERROR_NO_MEM:
+		return "insufficient memory";
+	case LIBUSB_ERROR_NOT_SUPPORTED:
+		return "operation not supported or unimplemented on this platform";
+	case LIBUSB_ERROR_OTHER:
+		return "other error";
+	default:
+		return "unknown error code";
+	}
+}
+
+
+
+libusb_transport::libusb_transport(int debug_level)
+{
+	TIMING_PHASE("libusb_init");
+	trace::span t("libusb_init");
+	int ret = t.end(libusb_init(CONTEXT));
+	if (ret < 0)
+		throw string("libusb_init: ") + usb_strerror(ret);
+	libusb_set_debug(CONTEXT, debug_level);
+}
+
+
+
+libusb_transport::~libusb_transport()
+{
+	trace::span t("libusb_exit");
+	libusb_exit(CONTEXT);
+	t.end(0);
+}
+
+
+
+int libusb_transport::open_devices(vector<usb_device *> &devices)
+{
+	libusb_device **list;
+	int num;
+	{
+		TIMING_PHASE("device list");
+		trace::span t("libusb_get_device_list");
+		num = t.end(libusb_get_device_list(CONTEXT, &list));
+	}
+	if (num < 0)
+		throw string("libusb_get_device_list: ") + usb_strerror(num);
+
+	for (int i = 0; i < num; i++) {
+		TIMING_PHASE("open");
+		libusb_device_handle *handle;
+		trace::span t("libusb_open");
+		t.arg("bus", libusb_get_bus_number(list[i])).arg("address", libusb_get_device_address(list[i]));
+		int ret = t.end(libusb_open(list[i], &handle));
+		if (ret) {
+			log(ALERT) << "error: libusb_open: " << usb_strerror(ret) << endl;
+			continue;
+		}
+		devices.push_back(new libusb_usb_device(handle));
+	}
+	libusb_free_device_list(list, 1);
+	return 0;
+}
+
+
+
+int libusb_transport::handle_events()
+{
+	return libusb_handle_events(CONTEXT);
+}
+
+
+
+int libusb_transport::get_pollfds(vector<pollfd> &fds, int *timeout)
+{
+	const libusb_pollfd **list = libusb_get_pollfds(CONTEXT);
+	if (!list)
+		return LIBUSB_ERROR_NOT_SUPPORTED;
+	for (int i = 0; list[i]; i++) {
+		pollfd pfd = { list[i]->fd, list[i]->events, 0 };
+		fds.push_back(pfd);
+	}
+	libusb_free_pollfds(list);
+
+	timeval tv;
+	int ret = libusb_get_next_timeout(CONTEXT, &tv);
+	if (ret < 0)
+		return ret;
+	*timeout = ret ? tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000 : -1;
+	return 0;
+}
+
+
+
+int libusb_transport::poll_events()
+{
+	timeval tv = { 0, 0 };
+	return libusb_handle_events_timeout(CONTEXT, &tv);
+}
+
+} // namespace bu0836
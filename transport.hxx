@@ -0,0 +1,118 @@
+// USB transport
+//
+// Copyright (C) 2010  Melchior FRANZ  <melchior.franz@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+#ifndef _TRANSPORT_HXX_
+#define _TRANSPORT_HXX_
+
+#include <libusb.h>
+#include <poll.h>
+#include <vector>
+
+
+
+namespace bu0836 {
+
+// The USB calls that manager and controller need. The libusb backend passes
+// them on to libusb, the simulator (simulator.hxx) answers them itself. All
+// of them return libusb error codes, and transfer callbacks get a
+// libusb_transfer_status.
+
+// An asynchronous control or interrupt transfer. Completed (or cancelled)
+// transfers call done() from transport::handle_events() or poll_events().
+class async_transfer {
+public:
+	typedef void (*callback)(async_transfer *, int status);
+
+	async_transfer() : done(0), user_data(0), transferred(0) {}
+	virtual ~async_transfer() {}
+
+	// For control transfers buf holds the setup packet (see
+	// libusb_fill_control_setup()) and the data, for interrupt transfers
+	// it takes the data. It must stay valid until done() was called.
+	virtual int submit(unsigned char *buf, unsigned int timeout) = 0;
+	virtual int cancel() = 0;
+
+	callback done;
+	void *user_data;
+	int transferred;             // data bytes, set before done()
+};
+
+
+
+// An opened USB device. Deleting it closes it.
+class usb_device {
+public:
+	virtual ~usb_device() {}
+	virtual int bus_number() = 0;
+	virtual int address() = 0;
+	virtual int get_device_descriptor(libusb_device_descriptor *desc) = 0;
+	virtual int get_string_descriptor_ascii(uint8_t index, unsigned char *buf, int length) = 0;
+	virtual int get_descriptor(uint8_t type, uint8_t index, unsigned char *buf, int length) = 0;
+	virtual int kernel_driver_active(int interface) = 0;
+	virtual int detach_kernel_driver(int interface) = 0;
+	virtual int attach_kernel_driver(int interface) = 0;
+	virtual int claim_interface(int interface) = 0;
+	virtual int release_interface(int interface) = 0;
+	virtual int control_transfer(uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+			unsigned char *data, uint16_t length, unsigned int timeout) = 0;
+	virtual int interrupt_transfer(unsigned char endpoint, unsigned char *data, int length,
+			int *transferred, unsigned int timeout) = 0;
+	virtual async_transfer *alloc_control_transfer() = 0;
+	virtual async_transfer *alloc_interrupt_transfer(unsigned char endpoint, int length) = 0; // 0 if not supported
+};
+
+
+
+class transport {
+public:
+	virtual ~transport() {}
+
+	// Opens all devices that can be opened and appends them to devices.
+	virtual int open_devices(std::vector<usb_device *> &devices) = 0;
+
+	// Waits for and completes asynchronous transfers.
+	virtual int handle_events() = 0;
+
+	// For event loops: appends the file descriptors to wait on, and sets
+	// timeout to the ms after which poll_events() is due anyway (-1: none).
+	virtual int get_pollfds(std::vector<pollfd> &fds, int *timeout) = 0;
+
+	// Completes the asynchronous transfers that are done, without waiting.
+	virtual int poll_events() = 0;
+};
+
+
+
+// libusb on its default context
+class libusb_transport : public transport {
+public:
+	explicit libusb_transport(int debug_level = 3);
+	~libusb_transport();
+	int open_devices(std::vector<usb_device *> &devices);
+	int handle_events();
+	int get_pollfds(std::vector<pollfd> &fds, int *timeout);
+	int poll_events();
+};
+
+
+
+const char *usb_strerror(int error);
+
+} // namespace bu0836
+
+#endif